@@ -0,0 +1,185 @@
+#include "asyncio.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <cerrno>
+
+#include <unistd.h>
+
+namespace {
+
+const std::size_t kWorkerCount = 4;
+
+class WorkerPool {
+public:
+    WorkerPool(std::size_t count) : stop_(false) {
+        for (std::size_t i = 0; i < count; ++i) {
+            workers_.emplace_back([this] { Work(); });
+        }
+    }
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto &&i : workers_) i.join();
+    }
+
+    void Submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    void Work() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+                if (stop_) return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    bool stop_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::thread> workers_;
+};
+
+WorkerPool &GetWorkerPool() {
+    static WorkerPool pool(kWorkerCount);
+    return pool;
+}
+
+} // namespace
+
+namespace zvm {
+
+struct AsyncIO::State {
+    struct Operation {
+        bool done;
+        Result result;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    unsigned int last_id = 0;
+    // operations are kept alive by workers even if they are removed
+    std::unordered_map<unsigned int, std::shared_ptr<Operation>> op_list;
+    std::unordered_set<unsigned int> completed;
+};
+
+AsyncIO::AsyncIO() : state_(std::make_shared<State>()) {}
+
+unsigned int AsyncIO::Read(int fd, long long offset, std::size_t size) {
+    auto op = std::make_shared<State::Operation>();
+    op->done = false;
+    op->result.is_read = true;
+    op->result.size = -1;
+    op->result.data.resize(size);
+    unsigned int id;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        id = ++state_->last_id;
+        state_->op_list[id] = op;
+    }
+    GetWorkerPool().Submit([state = state_, op, id, fd, offset] {
+        long long len = 0;
+        while (len < (long long)op->result.data.size()) {
+            auto ret = pread(fd, op->result.data.data() + len, op->result.data.size() - len, offset + len);
+            if (ret < 0 && errno == EINTR) continue;
+            if (ret < 0) len = -1;
+            if (ret <= 0) break;
+            len += ret;
+        }
+        std::lock_guard<std::mutex> lock(state->mutex);
+        op->result.size = len;
+        op->result.data.resize(len < 0 ? 0 : len);
+        op->done = true;
+        if (state->op_list.count(id)) state->completed.insert(id);
+        state->cv.notify_all();
+    });
+    return id;
+}
+
+unsigned int AsyncIO::Write(int fd, long long offset, const char *data, std::size_t size) {
+    auto op = std::make_shared<State::Operation>();
+    op->done = false;
+    op->result.is_read = false;
+    op->result.size = -1;
+    op->result.data.assign(data, data + size);
+    unsigned int id;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        id = ++state_->last_id;
+        state_->op_list[id] = op;
+    }
+    GetWorkerPool().Submit([state = state_, op, id, fd, offset] {
+        long long len = 0;
+        while (len < (long long)op->result.data.size()) {
+            auto ret = pwrite(fd, op->result.data.data() + len, op->result.data.size() - len, offset + len);
+            if (ret < 0 && errno == EINTR) continue;
+            if (ret < 0) len = -1;
+            if (ret <= 0) break;
+            len += ret;
+        }
+        std::lock_guard<std::mutex> lock(state->mutex);
+        op->result.size = len;
+        op->result.data.clear();
+        op->done = true;
+        if (state->op_list.count(id)) state->completed.insert(id);
+        state->cv.notify_all();
+    });
+    return id;
+}
+
+bool AsyncIO::Poll(unsigned int id, Result &result) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    auto it = state_->op_list.find(id);
+    if (it == state_->op_list.end() || !it->second->done) return false;
+    result = std::move(it->second->result);
+    state_->op_list.erase(it);
+    state_->completed.erase(id);
+    return true;
+}
+
+bool AsyncIO::Contains(unsigned int id) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->op_list.find(id) != state_->op_list.end();
+}
+
+bool AsyncIO::Wait() {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    if (state_->op_list.empty()) return false;
+    state_->cv.wait(lock, [this] { return !state_->completed.empty(); });
+    return true;
+}
+
+void AsyncIO::TakeCompleted(std::vector<unsigned int> &ids) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    ids.assign(state_->completed.begin(), state_->completed.end());
+    state_->completed.clear();
+}
+
+void AsyncIO::Clear() {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->op_list.clear();
+    state_->completed.clear();
+}
+
+} // namespace zvm
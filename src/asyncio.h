@@ -0,0 +1,50 @@
+#ifndef ZVM_ASYNCIO_H_
+#define ZVM_ASYNCIO_H_
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+namespace zvm {
+
+// asynchronous file operations of a VM instance, which are run by
+// a thread pool shared by all VM instances
+// operations use the given offset instead of the position of file
+class AsyncIO {
+public:
+    struct Result {
+        bool is_read;
+        // bytes transferred, -1 if failed
+        long long size;
+        std::vector<char> data;
+    };
+
+    AsyncIO();
+    AsyncIO(const AsyncIO &) = delete;
+    AsyncIO &operator=(const AsyncIO &) = delete;
+    ~AsyncIO() {}
+
+    // start an operation, return its id
+    unsigned int Read(int fd, long long offset, std::size_t size);
+    unsigned int Write(int fd, long long offset, const char *data, std::size_t size);
+    // return false if operation has not completed, otherwise get
+    // the result and remove the operation
+    bool Poll(unsigned int id, Result &result);
+    bool Contains(unsigned int id);
+    // wait until any of the operations completes after the last call
+    // of 'TakeCompleted', return false if there is no operation
+    bool Wait();
+    // get the ids of operations that completed after the last call
+    // and have not been polled
+    void TakeCompleted(std::vector<unsigned int> &ids);
+    // forget all of the operations
+    void Clear();
+
+private:
+    struct State;
+    std::shared_ptr<State> state_;
+};
+
+} // namespace zvm
+
+#endif // ZVM_ASYNCIO_H_
@@ -0,0 +1,168 @@
+#include "fiber.h"
+
+#include <utility>
+
+namespace {
+
+// index of registers, same as the order in instructions
+const int kRegRV = zvm::kRegisterCount - 2;
+const int kRegPC = zvm::kRegisterCount - 1;
+// maximum number of free stacks whose pages are kept for reuse
+const std::size_t kMaxFreeStacks = 64;
+
+} // namespace
+
+namespace zvm {
+
+void Scheduler::Save(Fiber *fiber) {
+    fiber->reg = reg_;
+    mem_.SwapStack(fiber->stack, fiber->stack_ptr);
+}
+
+void Scheduler::FreeStack(Fiber *fiber) {
+    stack_pool_.Release(fiber->stack, stack_pool_.free_count() >= kMaxFreeStacks);
+}
+
+void Scheduler::Load(Fiber *fiber) {
+    reg_ = fiber->reg;
+    mem_.SwapStack(fiber->stack, fiber->stack_ptr);
+    current_ = fiber;
+}
+
+void Scheduler::Wake() {
+    if (io_wait_list_.empty()) return;
+    async_.TakeCompleted(completed_);
+    for (const auto &id : completed_) {
+        auto range = io_wait_list_.equal_range(id);
+        for (auto it = range.first; it != range.second; ++it) {
+            ready_list_.push_back(it->second);
+        }
+        io_wait_list_.erase(range.first, range.second);
+    }
+}
+
+Scheduler::SwitchResult Scheduler::SwitchNext() {
+    Wake();
+    if (!ready_list_.empty()) {
+        Load(ready_list_.front());
+        ready_list_.pop_front();
+        return kSwitched;
+    }
+    if (!io_wait_list_.empty()) {
+        // load any of the waiting fibers, it will try
+        // its operation again when VM resumes
+        auto it = io_wait_list_.begin();
+        Load(it->second);
+        io_wait_list_.erase(it);
+        return kSuspend;
+    }
+    return kDeadlock;
+}
+
+unsigned int Scheduler::Spawn(MemSizeT position, Register env) {
+    if (!current_) {
+        // the main fiber, whose state is already in VM
+        auto main = std::make_unique<Fiber>();
+        main->id = 0;
+        main->stack_ptr = 0;
+        main->joiner = nullptr;
+        current_ = main.get();
+        fiber_list_[0] = std::move(main);
+    }
+    auto fiber = std::make_unique<Fiber>();
+    if (!stack_pool_.Acquire(mem_.stack_size(), fiber->stack)) return 0;
+    // returning from the function will finish the fiber
+    fiber->stack_ptr = sizeof(Register);
+    (*(Register *)fiber->stack.get()).long_long = kFiberReturn;
+    fiber->reg = reg_;
+    fiber->reg[kRegPC].long_long = position;
+    fiber->reg[kRegRV] = env;
+    fiber->joiner = nullptr;
+    do {
+        fiber->id = ++last_id_;
+    } while (!fiber->id || fiber_list_.count(fiber->id) || finished_list_.count(fiber->id));
+    auto id = fiber->id;
+    ready_list_.push_back(fiber.get());
+    fiber_list_[id] = std::move(fiber);
+    return id;
+}
+
+void Scheduler::Yield() {
+    if (ready_list_.empty()) return;
+    Save(current_);
+    ready_list_.push_back(current_);
+    SwitchNext();
+}
+
+Scheduler::SwitchResult Scheduler::Exit() {
+    auto fiber = current_;
+    if (!fiber->id) return kDeadlock;
+    auto id = fiber->id;
+    Save(fiber);
+    FreeStack(fiber);
+    if (fiber->joiner) {
+        fiber->joiner->reg[fiber->join_reg] = fiber->reg[kRegRV];
+        ready_list_.push_back(fiber->joiner);
+    }
+    else {
+        // keep only the return value until it is joined
+        finished_list_[id] = fiber->reg[kRegRV];
+    }
+    fiber_list_.erase(id);
+    // no fiber is loaded if there is nothing to switch to
+    current_ = nullptr;
+    return SwitchNext();
+}
+
+Scheduler::SwitchResult Scheduler::Join(unsigned int id, int reg_index) {
+    if (!current_ || !id) return kDeadlock;
+    auto finished = finished_list_.find(id);
+    if (finished != finished_list_.end()) {
+        reg_[reg_index] = finished->second;
+        finished_list_.erase(finished);
+        return kSwitched;
+    }
+    auto it = fiber_list_.find(id);
+    if (it == fiber_list_.end() || it->second.get() == current_ || it->second->joiner) {
+        return kDeadlock;
+    }
+    auto fiber = it->second.get();
+    fiber->joiner = current_;
+    fiber->join_reg = reg_index;
+    Save(current_);
+    return SwitchNext();
+}
+
+Scheduler::SwitchResult Scheduler::WaitIO(unsigned int id) {
+    Save(current_);
+    io_wait_list_.emplace(id, current_);
+    return SwitchNext();
+}
+
+void Scheduler::Resume() {
+    if (current_) {
+        Wake();
+    }
+    else {
+        // drop the operations that completed before, so that VM
+        // will not be woken up by them again
+        async_.TakeCompleted(completed_);
+    }
+}
+
+void Scheduler::Clear() {
+    if (fiber_list_.empty()) return;
+    auto main = fiber_list_[0].get();
+    if (current_ != main) {
+        if (current_) Save(current_);
+        Load(main);
+    }
+    for (const auto &i : fiber_list_) FreeStack(i.second.get());
+    ready_list_.clear();
+    io_wait_list_.clear();
+    fiber_list_.clear();
+    finished_list_.clear();
+    current_ = nullptr;
+}
+
+} // namespace zvm
@@ -0,0 +1,105 @@
+#ifndef ZVM_FIBER_H_
+#define ZVM_FIBER_H_
+
+#include <array>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "type.h"
+#include "vmem.h"
+#include "memman.h"
+#include "asyncio.h"
+
+namespace zvm {
+
+// return address of the function of a fiber, returning to it
+// means the fiber is finished
+const long long kFiberReturn = -1;
+// a running fiber will be preempted after this number of backward
+// branches if there are other fibers ready to run
+const int kFiberSlice = 1024;
+
+// round-robin scheduler of the fibers in a VM instance
+// all fibers share memory and GC pool of VM, and each of them has
+// its own registers and stack, the running fiber is loaded to the
+// registers and the stack of VM
+class Scheduler {
+public:
+    enum SwitchResult {
+        kSwitched,    // a fiber is loaded and can keep running
+        kSuspend,     // all fibers are waiting for asynchronous operations
+        kDeadlock     // no fiber can run any more
+    };
+
+    Scheduler(std::array<Register, kRegisterCount> &reg, MemoryManager &mem, AsyncIO &async)
+            : reg_(reg), mem_(mem), async_(async), current_(nullptr), last_id_(0) {}
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+    ~Scheduler() { Clear(); }
+
+    // if there is any fiber except the main one
+    bool active() const { return current_ != nullptr; }
+    bool has_ready() const { return !ready_list_.empty(); }
+
+    // create a fiber that runs function at 'position', registers
+    // are copied from the current fiber, except PC and RV
+    // return id of the new fiber, or 0 if failed
+    unsigned int Spawn(MemSizeT position, Register env);
+    // move the current fiber to the end of ready list
+    void Yield();
+    // current fiber returned from its function
+    SwitchResult Exit();
+    // wait for fiber 'id' to finish and store its return value
+    // to register 'reg_index' of the current fiber
+    // return 'kDeadlock' if 'id' is invalid
+    SwitchResult Join(unsigned int id, int reg_index);
+    // current fiber is waiting for asynchronous operation 'id'
+    SwitchResult WaitIO(unsigned int id);
+    // called before VM resumes, wake the fibers whose asynchronous
+    // operations have completed
+    void Resume();
+    // back to the main fiber and remove the others
+    void Clear();
+
+private:
+    struct Fiber {
+        unsigned int id;
+        std::array<Register, kRegisterCount> reg;
+        vmem::GuardedBlock stack;
+        MemSizeT stack_ptr;
+        // fiber that is waiting for this fiber
+        Fiber *joiner;
+        int join_reg;
+    };
+
+    void Save(Fiber *fiber);
+    // give back the stack of a fiber that will not run any more
+    void FreeStack(Fiber *fiber);
+    void Load(Fiber *fiber);
+    // move the fibers whose asynchronous operations have completed
+    // to ready list
+    void Wake();
+    // load the next fiber after the current one has been saved
+    SwitchResult SwitchNext();
+
+    std::array<Register, kRegisterCount> &reg_;
+    MemoryManager &mem_;
+    AsyncIO &async_;
+    Fiber *current_;
+    unsigned int last_id_;
+    // stacks of all fibers except the main one
+    vmem::BlockPool stack_pool_;
+    std::unordered_map<unsigned int, std::unique_ptr<Fiber>> fiber_list_;
+    // return values of the finished fibers that have not been joined
+    std::unordered_map<unsigned int, Register> finished_list_;
+    std::deque<Fiber *> ready_list_;
+    // fibers waiting for asynchronous operations, by id of operation
+    std::unordered_multimap<unsigned int, Fiber *> io_wait_list_;
+    std::vector<unsigned int> completed_;
+};
+
+} // namespace zvm
+
+#endif // ZVM_FIBER_H_
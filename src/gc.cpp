@@ -1,41 +1,50 @@
 #include "gc.h"
 
+#include <cstring>
+#include <vector>
+
 namespace zvm {
 
 bool GarbageCollector::Reallocate(MemSizeT need_size) {
     // mark unreachable object recursively
     Trace(root_id_);
 
-    temp_pool_ = std::make_unique<char[]>(pool_size_);   // TODO
+    // pages of temporary pool are kept after the first full GC,
+    // the two pools will be swapped after copying
+    if (!temp_pool_.get() && !temp_pool_.Allocate(pool_size_)) return false;
     gc_stack_ptr_ = 0;
-    auto total_size = need_size;
+    PoolSizeT total_size = need_size;
 
     for (auto i = obj_set_.begin(); i != obj_set_.end(); ) {
         auto &gco = i->second;
         // sweep unreachable object
-        if (!gco.reachable()) {
+        if (!gco.reachable() && !gco.interned()) {
+            if (gco.external()) FreeExternalObj(gco);
             free_id_.push_front(i->first);
             i = obj_set_.erase(i);
         }
         else {
             // reset reachable status
             gco.set_reachable(false);
+            // external object is not in the pool
+            if (gco.external()) {
+                ++i;
+                continue;
+            }
             total_size += gco.length();
             // completely full
             //     notice that if program were not forced to stop now
             //     the reachable status would be wrong
             if (total_size > pool_size_) return false;
             // copy to new pool
-            for (MemSizeT j = 0; j < gco.length(); ++j) {
-                temp_pool_[gc_stack_ptr_ + j] = gc_pool_[gco.position() + j];
-            }
+            memcpy(temp_pool_.get() + gc_stack_ptr_, gc_pool_.get() + gco.position(), gco.length());
             gco.set_position(gc_stack_ptr_);
             gc_stack_ptr_ += gco.length();
             ++i;   // increase iterator
         }
     }
     
-    gc_pool_ = std::move(temp_pool_);
+    std::swap(gc_pool_, temp_pool_);
     return true;
 }
 
@@ -63,11 +72,15 @@ unsigned int GarbageCollector::GetId()  {
 }
 
 void GarbageCollector::ResetGC()  {
-    gc_pool_ = std::make_unique<char[]>(pool_size_);
+    // untouched pages of pool will never be allocated, and pages that have
+    // been used are kept because new objects are always initialized
+    gc_error_ = gc_pool_.size() != pool_size_ && !gc_pool_.Allocate(pool_size_);
     gc_stack_ptr_ = 0;
     obj_id_ = root_id_ = 0;
+    FreeExternalObjs();
+    obj_set_.clear();
     free_id_.clear();
-    gc_error_ = false;
+    intern_table_.clear();
 }
 
 unsigned int GarbageCollector::AddObj(MemSizeT length) {
@@ -92,75 +105,101 @@ unsigned int GarbageCollector::AddObj(MemSizeT length) {
 }
 
 unsigned int GarbageCollector::AddObjFromMemory(const char *position, MemSizeT length) {
+    // data may be a part of GC pool or an external object,
+    // which will be moved or unmapped by full GC
+    std::unique_ptr<char[]> data_copy;
+    if (gc_stack_ptr_ + length >= pool_size_) {
+        data_copy = std::make_unique<char[]>(length);
+        memcpy(data_copy.get(), position, length);
+        position = data_copy.get();
+    }
+
     auto new_id = AddObj(length);
     if (gc_error_) return new_id;
 
     // copy to GC pool
-    for (MemSizeT i = 0; i < length; ++i) {
-        gc_pool_[gc_stack_ptr_ - length + i] = position[i];
-    }
+    memcpy(gc_pool_.get() + gc_stack_ptr_ - length, position, length);
 
     return new_id;
 }
 
 bool GarbageCollector::ExpandObj(unsigned int id, const char *data_pos, MemSizeT data_len, MemSizeT overlay) {
     auto it = obj_set_.find(id);
-    if (it == obj_set_.end()) return !(gc_error_ = true);
-    auto &obj = it->second;
+    if (it == obj_set_.end() || it->second.length() < overlay) return !(gc_error_ = true);
+    if (it->second.immutable()) return !(gc_error_ = true);
     // calculate the length of the original object
     // after excluding the overlay
-    auto obj_len = obj.length() - overlay;
-    if (obj_len <= 0) return !(gc_error_ = true);
+    auto obj_len = it->second.length() - overlay;
+    // length of an object can not exceed 'MemSizeT'
+    if (data_len > (MemSizeT)-1 - obj_len - 1) return !(gc_error_ = true);
+
+    // full GC (if needed) must be done before everything
+    // because it will move the objects
+    auto need_size = obj_len + data_len;
+    if (gc_stack_ptr_ + need_size >= pool_size_) {
+        // data may be a part of GC pool or an external object
+        auto data_copy = std::make_unique<char[]>(data_len);
+        memcpy(data_copy.get(), data_pos, data_len);
+        data_pos = data_copy.get();
+        if (!Reallocate(need_size + 1)) return !(gc_error_ = true);
+        it = obj_set_.find(id);
+        if (it == obj_set_.end()) return !(gc_error_ = true);
+        return ExpandObj(id, data_pos, data_len, overlay);
+    }
 
-    MemSizeT start_pos;
+    auto &obj = it->second;
+    obj.ClearHash();
+    PoolSizeT start_pos;
     // object is not on the top of GC pool
     if (obj.position() + obj.length() != gc_stack_ptr_) {
-        // allocate a new object
-        auto new_id = AddObj(obj_len + data_len);
-        if (gc_error_) return false;
-        // copy the data whose length is obj_len
-        // from the original object to the new object
-        auto new_it = obj_set_.find(new_id);
-        auto &new_obj = new_it->second;
-        auto obj_pos = obj.position();
-        start_pos = new_obj.position();
-        for (MemSizeT i = 0; i < obj_len; ++i) {
-            gc_pool_[start_pos + i] = gc_pool_[obj_pos + i];
-        }
-        // move the content of new object and the original one
-        // and delete the new object
-        obj = std::move(new_obj);   // TODO: test
-        obj_set_.erase(new_it);
+        // allocate a new object and copy the data whose length
+        // is obj_len from the original object to the new object
+        start_pos = gc_stack_ptr_;
+        memcpy(gc_pool_.get() + start_pos, gc_pool_.get() + obj.position(), obj_len);
+        obj.set_position(start_pos);
     }
     else {
         // just change stack pointer directly
-        auto size = data_len - overlay;
-        // full GC
-        if (gc_stack_ptr_ + size >= pool_size_) {
-            if (!Reallocate(size)) return !(gc_error_ = true);
-        }
-        gc_stack_ptr_ += size;
         start_pos = obj.position();
     }
+    obj.set_length(obj_len + data_len);
+    gc_stack_ptr_ = start_pos + obj_len + data_len;
 
     // copy the remaining data
-    for (MemSizeT i = 0; i < data_len; ++i) {
-        gc_pool_[start_pos + obj_len + i] = data_pos[i];
+    memcpy(gc_pool_.get() + start_pos + obj_len, data_pos, data_len);
+    return true;
+}
+
+bool GarbageCollector::ShrinkObj(unsigned int id, MemSizeT length) {
+    auto it = obj_set_.find(id);
+    if (it == obj_set_.end() || it->second.length() < length) return !(gc_error_ = true);
+    auto &gco = it->second;
+    if (gco.immutable()) return !(gc_error_ = true);
+    // object is on the top of the GC pool
+    if (gco.position() + gco.length() == gc_stack_ptr_) {
+        gc_stack_ptr_ -= gco.length() - length;
     }
+    gco.set_length(length);
+    gco.ClearHash();
     return true;
 }
 
 bool GarbageCollector::DeleteObj(unsigned int id) {
     auto it = obj_set_.find(id);
     if (it != obj_set_.end()) {
-        free_id_.push_back(it->first);
-        obj_set_.erase(it);
-        auto &gco = it->second;
+        const auto &gco = it->second;
+        // interned object can not be deleted
+        if (gco.interned()) return true;
+        if (gco.external()) {
+            FreeExternalObj(gco);
+        }
         // object is on the top of the GC pool
-        if (gco.position() + gco.length() == gc_stack_ptr_) {
+        else if (gco.position() + gco.length() == gc_stack_ptr_) {
             // restore stack pointer
             gc_stack_ptr_ -= gco.length();
         }
+        free_id_.push_back(it->first);
+        obj_set_.erase(it);
         return true;
     }
     else {
@@ -168,6 +207,77 @@ bool GarbageCollector::DeleteObj(unsigned int id) {
     }
 }
 
+bool GarbageCollector::ReplaceObj(unsigned int id, unsigned int new_id) {
+    auto it = obj_set_.find(id), new_it = obj_set_.find(new_id);
+    if (it == obj_set_.end() || new_it == obj_set_.end()) return !(gc_error_ = true);
+    auto &gco = it->second;
+    if (gco.external()) {
+        FreeExternalObj(gco);
+        gco.ClearExternal();
+    }
+    if (new_it->second.external()) gco.set_external();
+    gco.set_position(new_it->second.position());
+    gco.set_length(new_it->second.length());
+    gco.ClearHash();
+    free_id_.push_back(new_id);
+    obj_set_.erase(new_it);
+    return true;
+}
+
+bool GarbageCollector::Reserve(MemSizeT length) {
+    if (gc_stack_ptr_ + length >= pool_size_) {
+        if (!Reallocate(length + 1)) return !(gc_error_ = true);
+    }
+    return true;
+}
+
+unsigned int GarbageCollector::AddInternedObj(const char *position, MemSizeT length, unsigned int hash) {
+    auto range = intern_table_.equal_range(hash);
+    for (auto i = range.first; i != range.second; ++i) {
+        const auto &gco = obj_set_.find(i->second)->second;
+        if (gco.length() == length && !memcmp(gc_pool_.get() + gco.position(), position, length)) {
+            return i->second;
+        }
+    }
+
+    auto new_id = AddObjFromMemory(position, length);
+    if (gc_error_) return new_id;
+    auto &gco = obj_set_.find(new_id)->second;
+    gco.set_interned();
+    gco.set_hash(hash);
+    intern_table_.insert({hash, new_id});
+    return new_id;
+}
+
+unsigned int GarbageCollector::AddFileObj(char *data, std::size_t size) {
+    // length of object includes the zero byte after the file
+    if (size >= (MemSizeT)-1) {
+        vmem::UnmapFile(data, size);
+        gc_error_ = true;
+        return 0xFFFFFFFF;
+    }
+    auto new_id = GetId();
+    if (obj_id_ == 0xFFFFFFFF) {
+        vmem::UnmapFile(data, size);
+        gc_error_ = true;
+        return obj_id_;
+    }
+    gc::GCObject gco((PoolSizeT)data, size + 1);
+    gco.set_external();
+    obj_set_.insert(ObjSet::value_type(new_id, std::move(gco)));
+    return new_id;
+}
+
+void GarbageCollector::FreeExternalObj(const gc::GCObject &gco) {
+    vmem::UnmapFile((char *)gco.position(), gco.length() - 1);
+}
+
+void GarbageCollector::FreeExternalObjs() {
+    for (auto &&i : obj_set_) {
+        if (i.second.external()) FreeExternalObj(i.second);
+    }
+}
+
 void GarbageCollector::AddElem(unsigned int obj_id, unsigned int elem_id) {
     auto it = obj_set_.find(obj_id);
     if (it != obj_set_.end() && obj_set_.find(elem_id) != obj_set_.end()) {
@@ -195,8 +305,17 @@ char *GarbageCollector::AccessObj(unsigned int id) {
         gc_error_ = true;
         return nullptr;
     }
-    const auto &gco = it->second;
-    return gc_pool_.get() + gco.position();
+    return ObjData(it->second);
+}
+
+char *GarbageCollector::AccessObj(unsigned int id, MemSizeT &length) {
+    auto it = obj_set_.find(id);
+    if (it == obj_set_.end()) {
+        gc_error_ = true;
+        return nullptr;
+    }
+    length = it->second.length();
+    return ObjData(it->second);
 }
 
 MemSizeT GarbageCollector::GetObjLength(unsigned int id) {
@@ -208,4 +327,131 @@ MemSizeT GarbageCollector::GetObjLength(unsigned int id) {
     return it->second.length();
 }
 
+bool GarbageCollector::IsInterned(unsigned int id) {
+    auto it = obj_set_.find(id);
+    return it != obj_set_.end() && it->second.interned();
+}
+
+bool GarbageCollector::IsImmutable(unsigned int id) {
+    auto it = obj_set_.find(id);
+    return it != obj_set_.end() && it->second.immutable();
+}
+
+void GarbageCollector::SetContainer(unsigned int id) {
+    auto it = obj_set_.find(id);
+    if (it != obj_set_.end()) it->second.set_container();
+}
+
+bool GarbageCollector::IsContainer(unsigned int id) {
+    auto it = obj_set_.find(id);
+    return it != obj_set_.end() && it->second.container();
+}
+
+bool GarbageCollector::GetObjHash(unsigned int id, unsigned int &hash) {
+    auto it = obj_set_.find(id);
+    if (it == obj_set_.end() || !it->second.hashed()) return false;
+    hash = it->second.hash();
+    return true;
+}
+
+void GarbageCollector::SetObjHash(unsigned int id, unsigned int hash) {
+    auto it = obj_set_.find(id);
+    if (it != obj_set_.end()) it->second.set_hash(hash);
+}
+
+void GarbageCollector::ClearObjHash(unsigned int id) {
+    auto it = obj_set_.find(id);
+    if (it != obj_set_.end()) it->second.ClearHash();
+}
+
+bool GarbageCollector::SaveState(snapshot::ImageWriter &writer, snapshot::ImageHeader &header) {
+    // mapped files are not part of the image
+    for (const auto &i : obj_set_) {
+        if (i.second.external()) return false;
+    }
+    header.gc_pool_size = pool_size_;
+    header.gc_stack_ptr = gc_stack_ptr_;
+    header.obj_id = obj_id_;
+    header.root_id = root_id_;
+    header.gc_pool_offset = writer.WriteSection(gc_pool_.get(), gc_stack_ptr_);
+
+    // object table
+    header.obj_count = obj_set_.size();
+    header.obj_table_offset = writer.WriteSection(nullptr, 0);
+    header.obj_table_size = 0;
+    for (const auto &i : obj_set_) {
+        const auto &gco = i.second;
+        snapshot::ObjRecord record = {
+            i.first, gco.position(), gco.length(),
+            gco.interned(), gco.hashed(), gco.hash(), gco.container(),
+            (MemSizeT)gco.elem_list().size()
+        };
+        writer.Append(&record, sizeof(record));
+        for (const auto &elem : gco.elem_list()) {
+            writer.Append(&elem, sizeof(elem));
+        }
+        header.obj_table_size += sizeof(record) + record.elem_count * sizeof(unsigned int);
+    }
+
+    std::vector<unsigned int> free_id(free_id_.begin(), free_id_.end());
+    header.free_id_count = free_id.size();
+    header.free_id_offset = writer.WriteSection(free_id.data(), free_id.size() * sizeof(unsigned int));
+    return !writer.error();
+}
+
+bool GarbageCollector::LoadState(const snapshot::ImageReader &reader) {
+    const auto &header = reader.header();
+    pool_size_ = header.gc_pool_size;
+    ResetGC();
+    if (gc_error_) return false;
+    if (header.gc_stack_ptr > pool_size_) return !(gc_error_ = true);
+    if (!reader.MapSection(gc_pool_.get(), header.gc_pool_offset, header.gc_stack_ptr)) {
+        return !(gc_error_ = true);
+    }
+
+    // object table
+    if (!reader.Contains(header.obj_table_offset, header.obj_table_size)) return !(gc_error_ = true);
+    auto table = reader.section(header.obj_table_offset);
+    auto table_end = table + header.obj_table_size;
+    for (std::uint64_t i = 0; i < header.obj_count; ++i) {
+        snapshot::ObjRecord record;
+        if (table_end - table < (std::ptrdiff_t)sizeof(record)) return !(gc_error_ = true);
+        memcpy(&record, table, sizeof(record));
+        table += sizeof(record);
+        auto elem_size = (std::uint64_t)record.elem_count * sizeof(unsigned int);
+        if ((std::uint64_t)(table_end - table) < elem_size) return !(gc_error_ = true);
+        if (record.position + (std::uint64_t)record.length > header.gc_stack_ptr) {
+            return !(gc_error_ = true);
+        }
+        gc::GCObject gco(record.position, record.length);
+        if (record.hashed) gco.set_hash(record.hash);
+        if (record.container) gco.set_container();
+        if (record.interned) {
+            gco.set_interned();
+            intern_table_.insert({record.hash, record.id});
+        }
+        for (MemSizeT j = 0; j < record.elem_count; ++j) {
+            unsigned int elem;
+            memcpy(&elem, table + j * sizeof(elem), sizeof(elem));
+            gco.AddElem(elem);
+        }
+        table += elem_size;
+        obj_set_.insert(ObjSet::value_type(record.id, std::move(gco)));
+    }
+
+    auto free_id_size = header.free_id_count * sizeof(unsigned int);
+    if (!reader.Contains(header.free_id_offset, free_id_size)) return !(gc_error_ = true);
+    auto free_id = reader.section(header.free_id_offset);
+    for (std::uint64_t i = 0; i < header.free_id_count; ++i) {
+        unsigned int id;
+        memcpy(&id, free_id + i * sizeof(id), sizeof(id));
+        free_id_.push_back(id);
+    }
+
+    gc_stack_ptr_ = header.gc_stack_ptr;
+    obj_id_ = header.obj_id;
+    root_id_ = header.root_id;
+    return true;
+}
+
 } // namespace zvm
@@ -5,8 +5,11 @@
 #include <utility>
 #include <map>
 #include <deque>
+#include <unordered_map>
 
 #include "type.h"
+#include "vmem.h"
+#include "snapshot.h"
 
 namespace zvm {
 
@@ -16,12 +19,21 @@ class GCObject {
 public:
     using ElemList = std::deque<unsigned int>;
 
-    explicit GCObject(MemSizeT position, MemSizeT length)
-            : position_(position), length_(length), reachable_(false) {}
+    enum ObjFlag : unsigned int {
+        kObjHashed = 1 << 0,     // hash of object has been cached
+        kObjInterned = 1 << 1,   // object is immutable and will never be swept
+        kObjExternal = 1 << 2,   // object is a file mapping outside the pool
+        kObjContainer = 1 << 3   // object is a List or a Map
+    };
+
+    explicit GCObject(PoolSizeT position, MemSizeT length)
+            : position_(position), length_(length), reachable_(false),
+              flags_(0), hash_(0) {}
     // move constructor
     GCObject(GCObject &&gco) noexcept
             : position_(gco.position_), length_(gco.length_),
-              reachable_(gco.reachable_), elem_list_(std::move(gco.elem_list_)) {}
+              reachable_(gco.reachable_), flags_(gco.flags_), hash_(gco.hash_),
+              elem_list_(std::move(gco.elem_list_)) {}
     GCObject(const GCObject &gco) = delete;
     ~GCObject() {}
 
@@ -31,19 +43,40 @@ public:
             position_ = gco.position_;
             length_ = gco.length_;
             reachable_ = gco.reachable_;
+            flags_ = gco.flags_;
+            hash_ = gco.hash_;
             elem_list_ = std::move(gco.elem_list_);
         }
         return *this;
     }
     GCObject &operator=(const GCObject &gco) = delete;
 
-    MemSizeT position() const { return position_; }
+    PoolSizeT position() const { return position_; }
     MemSizeT length() const { return length_; }
     bool reachable() const { return reachable_; }
+    bool hashed() const { return flags_ & kObjHashed; }
+    bool interned() const { return flags_ & kObjInterned; }
+    bool external() const { return flags_ & kObjExternal; }
+    bool immutable() const { return flags_ & (kObjInterned | kObjExternal); }
+    bool container() const { return flags_ & kObjContainer; }
+    unsigned int hash() const { return hash_; }
     const ElemList &elem_list() const { return elem_list_; }
 
-    void set_position(MemSizeT position) { position_ = position; }
+    void set_position(PoolSizeT position) { position_ = position; }
+    void set_length(MemSizeT length) { length_ = length; }
     void set_reachable(bool reachable) { reachable_ = reachable; }
+    void set_interned() { flags_ |= kObjInterned; }
+    // position of external object is its address
+    void set_external() { flags_ |= kObjExternal; }
+    void ClearExternal() { flags_ &= ~kObjExternal; }
+    void set_container() { flags_ |= kObjContainer; }
+
+    void set_hash(unsigned int hash) {
+        hash_ = hash;
+        flags_ |= kObjHashed;
+    }
+    // must be called after the content of object is modified
+    void ClearHash() { flags_ &= ~kObjHashed; }
 
     // will not check if id is repeated
     void AddElem(unsigned int id) { elem_list_.push_back(id); }
@@ -59,8 +92,10 @@ public:
     }
 
 private:
-    MemSizeT position_, length_;
+    PoolSizeT position_;
+    MemSizeT length_;
     bool reachable_;
+    unsigned int flags_, hash_;
     ElemList elem_list_;
 };
 
@@ -70,29 +105,65 @@ class GarbageCollector {
 public:
     using ObjSet = std::map<unsigned int, gc::GCObject>;
 
-    GarbageCollector(MemSizeT pool_size) : pool_size_(pool_size) { ResetGC(); }
-    ~GarbageCollector() {}
+    GarbageCollector(PoolSizeT pool_size) : pool_size_(pool_size) { ResetGC(); }
+    ~GarbageCollector() { FreeExternalObjs(); }
 
     void ResetGC();
 
     unsigned int AddObj(MemSizeT length);
     unsigned int AddObjFromMemory(const char *position, MemSizeT length);
     bool ExpandObj(unsigned int id, const char *data_pos, MemSizeT data_len, MemSizeT overlay = 0);
+    // the remaining space will be freed in next full GC
+    bool ShrinkObj(unsigned int id, MemSizeT length);
     bool DeleteObj(unsigned int id);
+    // move the data of object 'new_id' to object 'id' and delete 'new_id'
+    // sub-objects of 'id' will be kept
+    bool ReplaceObj(unsigned int id, unsigned int new_id);
+    // make sure that the following allocations whose total length
+    // is not greater than 'length' will not trigger a full GC
+    bool Reserve(MemSizeT length);
+    // return the interned object whose content is the same as data,
+    // the object will be created if it does not exist
+    unsigned int AddInternedObj(const char *position, MemSizeT length, unsigned int hash);
+    // add a file mapping as an immutable object outside the pool,
+    // 'data' must be returned by 'vmem::MapFileZeroEnded', and will
+    // be unmapped when the object is swept
+    unsigned int AddFileObj(char *data, std::size_t size);
 
     void SetRootObj(unsigned int id) { root_id_ = id; }
     void AddElem(unsigned int obj_id, unsigned int elem_id);
     void DelElem(unsigned int obj_id, unsigned int elem_id);
 
     char *AccessObj(unsigned int id);
+    char *AccessObj(unsigned int id, MemSizeT &length);
     MemSizeT GetObjLength(unsigned int id);
+    bool IsInterned(unsigned int id);
+    // interned and external objects can not be modified
+    bool IsImmutable(unsigned int id);
+    // handles of List and Map are the same as String, so the type is
+    // recorded in the object
+    void SetContainer(unsigned int id);
+    bool IsContainer(unsigned int id);
+    // cached hash of object, return false if it has not been cached
+    bool GetObjHash(unsigned int id, unsigned int &hash);
+    void SetObjHash(unsigned int id, unsigned int hash);
+    void ClearObjHash(unsigned int id);
+
+    // save or load the pool and object table in snapshot image
+    bool SaveState(snapshot::ImageWriter &writer, snapshot::ImageHeader &header);
+    bool LoadState(const snapshot::ImageReader &reader);
 
     bool gc_error() const { return gc_error_; }
-    MemSizeT pool_size() const { return pool_size_; }
+    PoolSizeT pool_size() const { return pool_size_; }
 
 private:
     bool Reallocate(MemSizeT need_size);
     void Trace(unsigned int id);
+    char *ObjData(const gc::GCObject &gco) {
+        return gco.external() ? (char *)gco.position() : gc_pool_.get() + gco.position();
+    }
+    void FreeExternalObj(const gc::GCObject &gco);
+    void FreeExternalObjs();
 
     // garbage collector must ensure that when you add an object after
     // you deleted another object, GetId will return the id of the object
@@ -100,12 +171,14 @@ private:
     unsigned int GetId();
 
     bool gc_error_;
-    MemSizeT pool_size_, gc_stack_ptr_;
+    PoolSizeT pool_size_, gc_stack_ptr_;
     unsigned int obj_id_, root_id_;
-    std::unique_ptr<char[]> gc_pool_, temp_pool_;
+    vmem::LazyBlock gc_pool_, temp_pool_;
     // map: <id, GCObject>
     ObjSet obj_set_;
     std::deque<unsigned int> free_id_;
+    // multimap: <hash, id of interned object>
+    std::unordered_multimap<unsigned int, unsigned int> intern_table_;
 };
 
 } // namespace zvm
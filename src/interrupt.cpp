@@ -2,121 +2,186 @@
 
 #include <cstdio>
 #include <ctime>
-#include <string>
-#include <iostream>
+#include <cerrno>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#include "vecfunc.h"
 #include "xstl/str_hash.h"
 
 namespace {
 
-zvm::ZValue null_value, temp;
+// interrupts may be called from multiple VM instances at the same time,
+// so they should not modify any global state
+const zvm::ZValue kNullValue = {};
 
-zvm::ZValue PutChar(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
-    fputc((int)(arg[0].long_long & 0xFF), stderr);
-    return null_value;
+zvm::ZValue PutChar(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    io.WriteChar(zvm::IOManager::kPutChannel, (char)(arg[0].long_long & 0xFF));
+    return kNullValue;
 }
 
-zvm::ZValue GetChar(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
-    temp.num.long_long = (long long)getchar();
+zvm::ZValue GetChar(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
+    temp.num.long_long = io.ReadChar();
     return temp;
 }
 
-zvm::ZValue PutInteger(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
-    fprintf(stderr, "%lld", arg[0].long_long);
-    return null_value;
+zvm::ZValue PutInteger(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    io.WriteInteger(zvm::IOManager::kPutChannel, arg[0].long_long);
+    return kNullValue;
 }
 
-zvm::ZValue PutFloat(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
-    fprintf(stderr, "%lf", arg[0].doub);
-    return null_value;
+zvm::ZValue PutFloat(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    io.WriteFloat(zvm::IOManager::kPutChannel, arg[0].doub);
+    return kNullValue;
 }
 
-zvm::ZValue PutString(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue PutString(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     temp.num = arg[0];
-    fprintf(stderr, "%s", mem.GetRawString(temp.str));
-    return null_value;
+    io.WriteString(zvm::IOManager::kPutChannel, mem.GetRawString(temp.str));
+    return kNullValue;
 }
 
-zvm::ZValue PutRawString(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
-    fprintf(stderr, "%s", &mem[arg[0].long_long]);
-    return null_value;
+zvm::ZValue PutRawString(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    io.WriteString(zvm::IOManager::kPutChannel, &mem[arg[0].long_long]);
+    return kNullValue;
 }
 
-zvm::ZValue GetInteger(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue GetInteger(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     temp.num.long_long = 0;
-    scanf("%lld", &temp.num.long_long);
+    io.ReadInteger(temp.num.long_long);
     return temp;
 }
 
-zvm::ZValue GetFloat(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue GetFloat(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     temp.num.doub = 0;
-    scanf("%lf", &temp.num.doub);
+    io.ReadFloat(temp.num.doub);
     return temp;
 }
 
-zvm::ZValue GetString(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue GetString(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     temp.num = arg[0];
-    std::string temp_str;
-    std::cin >> temp_str;
-    mem.SetRawString(temp.str, temp_str.c_str());
+    std::size_t len;
+    auto word = io.ReadToken(len);
+    if (!word) word = "", len = 0;
+    mem.SetRawString(temp.str, word, len);
+    return temp;
+}
+
+zvm::ZValue GetNewString(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
+    std::size_t len;
+    auto word = io.ReadToken(len);
+    if (!word) word = "", len = 0;
+    temp.str = mem.AddStringObj(word, len);
+    return temp;
+}
+
+zvm::ZValue ReadLine(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // RV = new string, or -1 if reached EOF
+    zvm::ZValue temp = {};
+    std::size_t len;
+    auto line = io.ReadLine(len);
+    if (line) {
+        temp.str = mem.AddStringObj(line, len);
+    }
+    else {
+        temp.num.long_long = -1;
+    }
     return temp;
 }
 
-zvm::ZValue GetNewString(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
-    std::string temp_str;
-    std::cin >> temp_str;
-    temp.str = mem.AddStringObj(temp_str);
+zvm::ZValue ReadAll(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
+    std::size_t len;
+    auto text = io.ReadAll(len);
+    if (!text) text = "", len = 0;
+    temp.str = mem.AddStringObj(text, len);
     return temp;
 }
 
-zvm::ZValue AddChar(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
-    putchar((int)(arg[0].long_long & 0xFF));
-    return null_value;
+zvm::ZValue AddChar(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    io.WriteChar(zvm::IOManager::kAddChannel, (char)(arg[0].long_long & 0xFF));
+    return kNullValue;
 }
 
-zvm::ZValue AddString(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue AddString(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     temp.num = arg[0];
-    printf("%s", mem.GetRawString(temp.str));
-    return null_value;
+    io.WriteString(zvm::IOManager::kAddChannel, mem.GetRawString(temp.str));
+    return kNullValue;
 }
 
-zvm::ZValue AddRawString(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
-    printf("%s", &mem[arg[0].long_long]);
-    return null_value;
+zvm::ZValue AddRawString(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    io.WriteString(zvm::IOManager::kAddChannel, &mem[arg[0].long_long]);
+    return kNullValue;
 }
 
-zvm::ZValue Flush(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue Flush(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
     switch (arg[0].long_long) {
         case 0: {
-            fflush(stdin);
+            io.ClearInput();
             break;
         }
         case 1: {
-            fflush(stdout);
+            // output of VM
+            io.Flush();
             break;
         }
         default: {
             fflush((FILE *)arg[0].long_long);
         }
     }
-    return null_value;
+    return kNullValue;
+}
+
+long long GetClockTime(clockid_t clock_id) {
+    timespec ts;
+    clock_gettime(clock_id, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+zvm::ZValue GetMillisecond(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // wall time from an unspecified starting point
+    zvm::ZValue temp = {};
+    temp.num.long_long = GetClockTime(CLOCK_MONOTONIC) / 1000000;
+    return temp;
+}
+
+zvm::ZValue GetNanosecond(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
+    temp.num.long_long = GetClockTime(CLOCK_MONOTONIC);
+    return temp;
 }
 
-zvm::ZValue GetMillisecond(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
-    temp.num.long_long = (long long)clock() * 1000 / CLOCKS_PER_SEC;
+zvm::ZValue GetCpuTime(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // CPU time of process in nanoseconds
+    zvm::ZValue temp = {};
+    temp.num.long_long = GetClockTime(CLOCK_PROCESS_CPUTIME_ID);
     return temp;
 }
 
-zvm::ZValue Sleep(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
-    auto now = clock();
-    auto duration = arg[0].long_long * CLOCKS_PER_SEC / 1000;
-    while (clock() - now < duration);
-    return null_value;
+zvm::ZValue Sleep(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : duration in milliseconds
+    if (arg[0].long_long <= 0) return kNullValue;
+    // output should not be delayed by sleeping
+    io.Flush();
+    timespec ts = {(time_t)(arg[0].long_long / 1000), (long)(arg[0].long_long % 1000 * 1000000)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR);
+    return kNullValue;
 }
 
-zvm::ZValue OpenFile(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue OpenFile(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
     // arg[0] : file path
     // arg[1] : 0 -> read, 1 -> write, 2 -> read & write
+    zvm::ZValue temp = {};
     temp.num = arg[0];
     const char *file_mode[] = {"rb", "wb", "wb+"};
     FILE *file_ptr = fopen(mem.GetRawString(temp.str), file_mode[arg[1].long_long]);
@@ -124,54 +189,525 @@ zvm::ZValue OpenFile(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
     return temp;
 }
 
-zvm::ZValue CloseFile(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue CloseFile(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     temp.num.long_long = fclose((FILE *)arg[0].long_long);
     return temp;
 }
 
-zvm::ZValue ReadByte(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue ReadByte(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     char buffer;
     fread(&buffer, sizeof(char), 1, (FILE *)arg[0].long_long);
     temp.num.long_long = (long long)buffer;
     return temp;
 }
 
-zvm::ZValue ReadReg(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue ReadReg(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     fread(&temp.num.long_long, sizeof(long long), 1, (FILE *)arg[0].long_long);
     return temp;
 }
 
-zvm::ZValue WriteByte(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue WriteByte(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     char buffer = arg[1].long_long & 0xFF;
     temp.num.long_long = (long long)fwrite(&buffer, sizeof(char), 1, (FILE *)arg[0].long_long);
     return temp;
 }
 
-zvm::ZValue WriteReg(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue WriteReg(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     temp.num.long_long = (long long)fwrite(&arg[1].long_long, sizeof(long long), 1, (FILE *)arg[0].long_long);
     return temp;
 }
 
-zvm::ZValue Tell(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue ReadBuffer(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : file pointer
+    // arg[1] : buffer, will be filled as much as possible
+    zvm::ZValue temp = {};
+    temp.num = arg[1];
+    zvm::MemSizeT size;
+    auto data = mem.AccessBuffer(temp.buf, size);
+    temp.num.long_long = data ? (long long)fread(data, sizeof(char), size, (FILE *)arg[0].long_long) : 0;
+    return temp;
+}
+
+zvm::ZValue WriteBuffer(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
+    temp.num = arg[1];
+    zvm::MemSizeT size;
+    auto data = mem.AccessBuffer(temp.buf, size);
+    temp.num.long_long = data ? (long long)fwrite(data, sizeof(char), size, (FILE *)arg[0].long_long) : 0;
+    return temp;
+}
+
+// check if the range is in program memory
+bool CheckMemoryRange(zvm::IntFuncMem mem, long long address, long long size) {
+    if (address < 0 || size < 0 || address > mem.memory_size()
+            || size > mem.memory_size() - address) {
+        mem.set_mem_error();
+        return false;
+    }
+    return true;
+}
+
+zvm::ZValue ReadBlock(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : file pointer
+    // arg[1] : address in memory
+    // arg[2] : size in bytes
+    zvm::ZValue temp = {};
+    temp.num.long_long = 0;
+    if (CheckMemoryRange(mem, arg[1].long_long, arg[2].long_long)) {
+        temp.num.long_long = (long long)fread(&mem[arg[1].long_long], sizeof(char), arg[2].long_long, (FILE *)arg[0].long_long);
+    }
+    return temp;
+}
+
+zvm::ZValue WriteBlock(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
+    temp.num.long_long = 0;
+    if (CheckMemoryRange(mem, arg[1].long_long, arg[2].long_long)) {
+        temp.num.long_long = (long long)fwrite(&mem[arg[1].long_long], sizeof(char), arg[2].long_long, (FILE *)arg[0].long_long);
+    }
+    return temp;
+}
+
+zvm::ZValue ReadString(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : file pointer
+    // arg[1] : maximum size in bytes
+    // RV = new string, which is empty if reached EOF
+    zvm::ZValue temp = {};
+    char *data;
+    if (arg[1].long_long < 0 || arg[1].long_long >= 0xFFFFFFFF) {
+        mem.set_mem_error();
+        return kNullValue;
+    }
+    auto size = (zvm::MemSizeT)arg[1].long_long;
+    temp.str = mem.AllocStringObj(size, data);
+    if (!data) return temp;
+    auto len = fread(data, sizeof(char), size, (FILE *)arg[0].long_long);
+    if (len != size) mem.TruncateString(temp.str, len);
+    return temp;
+}
+
+zvm::ZValue WriteString(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : file pointer
+    // arg[1] : string
+    zvm::ZValue temp = {};
+    temp.num = arg[1];
+    zvm::MemSizeT len;
+    auto data = mem.GetRawString(temp.str, len);
+    temp.num.long_long = data ? (long long)fwrite(data, sizeof(char), len, (FILE *)arg[0].long_long) : 0;
+    return temp;
+}
+
+zvm::ZValue ReadFile(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : file path
+    // RV = new string of the whole file, or -1 if failed
+    zvm::ZValue temp = {};
+    temp.num = arg[0];
+    auto path = mem.GetRawString(temp.str);
+    temp.num.long_long = -1;
+    if (!path) return temp;
+    auto fd = open(path, O_RDONLY);
+    if (fd < 0) return temp;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0 || file_stat.st_size >= 0xFFFFFFFF) {
+        close(fd);
+        return temp;
+    }
+    // file is read directly into the new string
+    char *data;
+    zvm::MemSizeT size = file_stat.st_size, len = 0;
+    auto str = mem.AllocStringObj(size, data);
+    while (data && len < size) {
+        auto ret = read(fd, data + len, size - len);
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret <= 0) break;
+        len += ret;
+    }
+    close(fd);
+    if (!data) return temp;
+    if (len != size) mem.TruncateString(str, len);
+    temp.str = str;
+    return temp;
+}
+
+zvm::ZValue MapFile(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : file path
+    // RV = immutable string of the whole file, or -1 if failed
+    zvm::ZValue temp = {};
+    temp.num = arg[0];
+    auto path = mem.GetRawString(temp.str);
+    if (!path || !mem.MapFileString(path, temp.str)) temp.num.long_long = -1;
+    return temp;
+}
+
+zvm::ZValue Tell(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
     temp.num.long_long = (long long)ftell((FILE *)arg[0].long_long);
     return temp;
 }
 
-zvm::ZValue Seek(zvm::IntFuncArg arg, zvm::IntFuncMem mem) {
+zvm::ZValue Seek(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
     // arg[0] : file pointer
     // arg[1] : offset
     // arg[2] : 0 -> set, 1 -> cur, 2 -> end
+    zvm::ZValue temp = {};
     auto seek_mode = arg[2].long_long == 0 ? SEEK_SET : arg[2].long_long == 1 ? SEEK_CUR : SEEK_END;
     temp.num.long_long = (long long)fseek((FILE *)arg[0].long_long, (long int)arg[1].long_long, seek_mode);
     return temp;
 }
 
+// asynchronous file operations
+//     operations use the given offset and do not move the position of file
+
+zvm::ZValue ReadAsync(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : file pointer
+    // arg[1] : offset
+    // arg[2] : size in bytes
+    // RV = id of operation
+    zvm::ZValue temp = {};
+    if (arg[1].long_long < 0 || arg[2].long_long < 0 || arg[2].long_long >= 0xFFFFFFFF) {
+        mem.set_mem_error();
+        return kNullValue;
+    }
+    auto fd = fileno((FILE *)arg[0].long_long);
+    temp.num.long_long = io.async().Read(fd, arg[1].long_long, arg[2].long_long);
+    return temp;
+}
+
+zvm::ZValue WriteAsync(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : file pointer
+    // arg[1] : offset
+    // arg[2] : string, which is copied before returning
+    // RV = id of operation
+    zvm::ZValue temp = {};
+    temp.num = arg[2];
+    zvm::MemSizeT len;
+    auto data = mem.GetRawString(temp.str, len);
+    if (!data || arg[1].long_long < 0) {
+        mem.set_mem_error();
+        return kNullValue;
+    }
+    // data written by 'fwrite' must reach the file first
+    auto file = (FILE *)arg[0].long_long;
+    fflush(file);
+    temp.num.long_long = io.async().Write(fileno(file), arg[1].long_long, data, len);
+    return temp;
+}
+
+zvm::ZValue Await(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : id of operation
+    // RV = new string (read) or bytes written (write), -1 if failed
+    // VM will be suspended until the operation completes
+    zvm::ZValue temp = {};
+    zvm::AsyncIO::Result result;
+    auto id = (unsigned int)arg[0].long_long;
+    temp.num.long_long = -1;
+    if (!io.async().Poll(id, result)) {
+        if (io.async().Contains(id)) io.Suspend();
+        return temp;
+    }
+    if (result.size < 0) return temp;
+    if (result.is_read) {
+        temp.str = mem.AddStringObj(result.data.data(), result.data.size());
+    }
+    else {
+        temp.num.long_long = result.size;
+    }
+    return temp;
+}
+
+// sockets
+//     handles of sockets are file descriptors, all sockets are non-blocking
+//     and watched for reading after they are created
+
+zvm::ZValue OpenSocket(zvm::IntFuncIO io, int fd) {
+    zvm::ZValue temp = {};
+    if (fd >= 0) {
+        if (io.poller().Watch(fd, zvm::net::kPollRead)) {
+            io.AddSocket(fd);
+        }
+        else {
+            close(fd);
+            fd = -1;
+        }
+    }
+    temp.num.long_long = fd;
+    return temp;
+}
+
+zvm::ZValue Listen(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : address, "unix:<path>" or "<IPv4 address>:<port>"
+    // RV = listening socket, -1 if failed
+    zvm::ZValue temp = {};
+    temp.num = arg[0];
+    auto address = mem.GetRawString(temp.str);
+    return OpenSocket(io, address ? zvm::net::Listen(address, SOMAXCONN) : -1);
+}
+
+zvm::ZValue Connect(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
+    temp.num = arg[0];
+    auto address = mem.GetRawString(temp.str);
+    return OpenSocket(io, address ? zvm::net::Connect(address) : -1);
+}
+
+zvm::ZValue Accept(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : listening socket
+    // RV = new connection, -1 if there is no pending connection
+    return OpenSocket(io, zvm::net::Accept(arg[0].long_long));
+}
+
+zvm::ZValue SockRead(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : socket
+    // arg[1] : maximum size in bytes
+    // RV = new string, empty if connection is closed or failed,
+    //      -1 if there is no data to read
+    zvm::ZValue temp = {};
+    char *data;
+    if (arg[1].long_long <= 0 || arg[1].long_long >= 0xFFFFFFFF) {
+        mem.set_mem_error();
+        return kNullValue;
+    }
+    temp.str = mem.AllocStringObj(arg[1].long_long, data);
+    if (!data) return temp;
+    ssize_t len;
+    while ((len = read(arg[0].long_long, data, arg[1].long_long)) < 0 && errno == EINTR);
+    auto again = len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    mem.TruncateString(temp.str, len < 0 ? 0 : len);
+    if (again) temp.num.long_long = -1;
+    return temp;
+}
+
+zvm::ZValue SockWrite(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : socket
+    // arg[1] : string
+    // RV = bytes written, which may be less than the length of string
+    //      if the socket is not ready for writing, -1 if failed
+    zvm::ZValue temp = {};
+    temp.num = arg[1];
+    zvm::MemSizeT len;
+    auto data = mem.GetRawString(temp.str, len);
+    temp.num.long_long = -1;
+    if (!data) return temp;
+    ssize_t ret;
+    while ((ret = send(arg[0].long_long, data, len, MSG_NOSIGNAL)) < 0 && errno == EINTR);
+    if (ret >= 0) {
+        temp.num.long_long = ret;
+    }
+    else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        temp.num.long_long = 0;
+    }
+    return temp;
+}
+
+zvm::ZValue SockClose(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
+    temp.num.long_long = io.CloseSocket(arg[0].long_long);
+    return temp;
+}
+
+zvm::ZValue Watch(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : file descriptor
+    // arg[1] : events, 1 -> read, 2 -> write, 0 -> stop watching
+    // RV = 0 if succeeded, -1 if failed
+    zvm::ZValue temp = {};
+    temp.num.long_long = io.poller().Watch(arg[0].long_long, arg[1].long_long) ? 0 : -1;
+    return temp;
+}
+
+zvm::ZValue Poll(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : timeout in milliseconds, -1 means forever
+    // RV = new list of ready file descriptors, -1 if failed
+    zvm::ZValue temp = {};
+    std::vector<int> ready;
+    // output should not be delayed by waiting
+    if (arg[0].long_long) io.Flush();
+    auto timeout = arg[0].long_long < 0 ? -1 : arg[0].long_long > 0x7FFFFFFF ? 0x7FFFFFFF : (int)arg[0].long_long;
+    if (!io.poller().Wait(timeout, ready)) {
+        temp.num.long_long = -1;
+        return temp;
+    }
+    std::vector<zvm::ZValue> list(ready.size());
+    for (std::size_t i = 0; i < ready.size(); ++i) list[i].num.long_long = ready[i];
+    temp.list = mem.AddListObj(list.data(), list.size());
+    return temp;
+}
+
+// messages
+//     every VM can own a mailbox which is identified by a number, Strings
+//     and Buffers are copied into the GC pool of the receiver
+
+zvm::ZValue MailboxId(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // RV = id of mailbox of current VM, -1 if there is no mailbox
+    zvm::ZValue temp = {};
+    temp.num.long_long = io.mailbox() ? (long long)io.mailbox()->id() : -1;
+    return temp;
+}
+
+zvm::ZValue Send(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : id of mailbox
+    // arg[1] : String or Buffer
+    // RV = 1 if sent, 0 if mailbox is full, -1 if there is no such mailbox
+    zvm::ZValue temp = {}, obj;
+    zvm::Message message;
+    zvm::MemSizeT len;
+    const char *data;
+    obj.num = arg[1];
+    if (!obj.buf.type) {
+        // elements of List and Map may refer to objects of sender
+        if (mem.IsContainer(obj.str)) {
+            mem.set_mem_error();
+            return kNullValue;
+        }
+        data = mem.GetRawString(obj.str, len);
+        message.length = len;
+    }
+    else {
+        data = mem.AccessBuffer(obj.buf, len);
+        message.length = mem.BufferLength(obj.buf);
+    }
+    if (!data) return kNullValue;
+    temp.num.long_long = -1;
+    if (arg[0].long_long < 0 || arg[0].long_long > 0xFFFFFFFF) return temp;
+    auto mailbox = io.FindMailbox(arg[0].long_long);
+    if (!mailbox) return temp;
+    message.type = obj.buf.type;
+    message.data.assign(data, len);
+    temp.num.long_long = mailbox->Send(message) ? 1 : 0;
+    // the mailbox may have been dropped by its owner, so that it
+    // will never be emptied, find it again next time
+    if (!temp.num.long_long) io.DropMailbox(arg[0].long_long);
+    return temp;
+}
+
+zvm::ZValue Recv(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    // arg[0] : timeout in milliseconds, -1 means forever
+    // RV = new String or Buffer, -1 if there is no message
+    zvm::ZValue temp = {};
+    temp.num.long_long = -1;
+    const auto &mailbox = io.mailbox();
+    if (!mailbox) return temp;
+    // output should not be delayed by waiting
+    if (arg[0].long_long) io.Flush();
+    auto timeout = arg[0].long_long < 0 ? -1 : arg[0].long_long > 0x7FFFFFFF ? 0x7FFFFFFF : (int)arg[0].long_long;
+    zvm::Message message;
+    if (!mailbox->Wait(timeout) || !mailbox->Receive(message)) return temp;
+    if (!message.type) {
+        temp.str = mem.AddStringObj(message.data.data(), message.data.size());
+    }
+    else {
+        zvm::MemSizeT size;
+        temp.buf = mem.AddBufferObj(message.type, message.length);
+        if (mem.mem_error()) return kNullValue;
+        auto data = mem.AccessBuffer(temp.buf, size);
+        if (data && size == message.data.size()) memcpy(data, message.data.data(), size);
+    }
+    return temp;
+}
+
+// vector operations
+//     vector operand can be a List or a Buffer, and the elements of
+//     List are treated as integers, unless the last argument is 1
+//     binary operations require same type and same length of operands
+
+template <typename Func>
+zvm::ZValue VecReduce(zvm::IntFuncArg arg, zvm::IntFuncMem mem, Func func) {
+    zvm::ZValue temp = {};
+    temp.num = arg[0];
+    zvm::MemSizeT len;
+    unsigned int type;
+    auto data = mem.AccessVector(temp, arg[1].long_long == 1, len, type);
+    temp.num = data ? func(data, len, type) : kNullValue.num;
+    return temp;
+}
+
+template <typename Func>
+zvm::ZValue VecBinary(zvm::IntFuncArg arg, zvm::IntFuncMem mem, Func func) {
+    zvm::ZValue temp = {};
+    zvm::ZValue vec1 = {arg[0]}, vec2 = {arg[1]};
+    auto float_list = arg[2].long_long == 1;
+    zvm::MemSizeT len1, len2;
+    unsigned int type1, type2;
+    auto data1 = mem.AccessVector(vec1, float_list, len1, type1);
+    auto data2 = mem.AccessVector(vec2, float_list, len2, type2);
+    temp = kNullValue;
+    if (!data1 || !data2) return temp;
+    if (len1 != len2 || type1 != type2) {
+        mem.set_mem_error();
+        return temp;
+    }
+    func(data1, data2, len1, type1, temp.num);
+    return temp;
+}
+
+template <typename Func>
+zvm::ZValue VecScalar(zvm::IntFuncArg arg, zvm::IntFuncMem mem, Func func) {
+    zvm::ZValue temp = {};
+    temp.num = arg[0];
+    zvm::MemSizeT len;
+    unsigned int type;
+    auto data = mem.AccessVector(temp, arg[2].long_long == 1, len, type);
+    if (data) func(data, len, type, arg[1]);
+    return kNullValue;
+}
+
+zvm::ZValue VecSum(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    return VecReduce(arg, mem, zvm::vecfunc::Sum);
+}
+
+zvm::ZValue VecMin(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    return VecReduce(arg, mem, zvm::vecfunc::Min);
+}
+
+zvm::ZValue VecMax(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    return VecReduce(arg, mem, zvm::vecfunc::Max);
+}
+
+zvm::ZValue VecDot(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    return VecBinary(arg, mem, [](char *data1, char *data2, zvm::MemSizeT len, unsigned int type, zvm::Register &ret) {
+        ret = zvm::vecfunc::Dot(data1, data2, len, type);
+    });
+}
+
+zvm::ZValue VecAdd(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    return VecBinary(arg, mem, [](char *data1, char *data2, zvm::MemSizeT len, unsigned int type, zvm::Register &ret) {
+        zvm::vecfunc::Add(data1, data2, len, type);
+    });
+}
+
+zvm::ZValue VecMul(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    return VecBinary(arg, mem, [](char *data1, char *data2, zvm::MemSizeT len, unsigned int type, zvm::Register &ret) {
+        zvm::vecfunc::Mul(data1, data2, len, type);
+    });
+}
+
+zvm::ZValue VecAddScalar(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    return VecScalar(arg, mem, zvm::vecfunc::AddScalar);
+}
+
+zvm::ZValue VecMulScalar(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    return VecScalar(arg, mem, zvm::vecfunc::MulScalar);
+}
+
+zvm::ZValue VecPrefixSum(zvm::IntFuncArg arg, zvm::IntFuncMem mem, zvm::IntFuncIO io) {
+    zvm::ZValue temp = {};
+    temp.num = arg[0];
+    zvm::MemSizeT len;
+    unsigned int type;
+    auto data = mem.AccessVector(temp, arg[1].long_long == 1, len, type);
+    if (data) zvm::vecfunc::PrefixSum(data, len, type);
+    return kNullValue;
+}
+
 } // namespace
 
 namespace zvm {
 
 InterruptManager::InterruptManager() {
-    null_value.num.long_long = 0;
     RegisterInterrupt("PutChar", PutChar);
     RegisterInterrupt("GetChar", GetChar);
     RegisterInterrupt("PutInteger", PutInteger);
@@ -182,11 +718,15 @@ InterruptManager::InterruptManager() {
     RegisterInterrupt("GetFloat", GetFloat);
     RegisterInterrupt("GetString", GetString);
     RegisterInterrupt("GetNewString", GetNewString);
+    RegisterInterrupt("ReadLine", ReadLine);
+    RegisterInterrupt("ReadAll", ReadAll);
     RegisterInterrupt("AddChar", AddChar);
     RegisterInterrupt("AddString", AddString);
     RegisterInterrupt("AddRawString", AddRawString);
     RegisterInterrupt("Flush", Flush);
     RegisterInterrupt("GetMillisecond", GetMillisecond);
+    RegisterInterrupt("GetNanosecond", GetNanosecond);
+    RegisterInterrupt("GetCpuTime", GetCpuTime);
     RegisterInterrupt("Sleep", Sleep);
     RegisterInterrupt("OpenFile", OpenFile);
     RegisterInterrupt("CloseFile", CloseFile);
@@ -194,8 +734,39 @@ InterruptManager::InterruptManager() {
     RegisterInterrupt("ReadReg", ReadReg);
     RegisterInterrupt("WriteByte", WriteByte);
     RegisterInterrupt("WriteReg", WriteReg);
+    RegisterInterrupt("ReadBuffer", ReadBuffer);
+    RegisterInterrupt("WriteBuffer", WriteBuffer);
+    RegisterInterrupt("ReadBlock", ReadBlock);
+    RegisterInterrupt("WriteBlock", WriteBlock);
+    RegisterInterrupt("ReadString", ReadString);
+    RegisterInterrupt("WriteString", WriteString);
+    RegisterInterrupt("ReadFile", ReadFile);
+    RegisterInterrupt("MapFile", MapFile);
     RegisterInterrupt("Tell", Tell);
     RegisterInterrupt("Seek", Seek);
+    RegisterInterrupt("ReadAsync", ReadAsync);
+    RegisterInterrupt("WriteAsync", WriteAsync);
+    RegisterInterrupt("Await", Await);
+    RegisterInterrupt("Listen", Listen);
+    RegisterInterrupt("Connect", Connect);
+    RegisterInterrupt("Accept", Accept);
+    RegisterInterrupt("SockRead", SockRead);
+    RegisterInterrupt("SockWrite", SockWrite);
+    RegisterInterrupt("SockClose", SockClose);
+    RegisterInterrupt("Watch", Watch);
+    RegisterInterrupt("Poll", Poll);
+    RegisterInterrupt("MailboxId", MailboxId);
+    RegisterInterrupt("Send", Send);
+    RegisterInterrupt("Recv", Recv);
+    RegisterInterrupt("VecSum", VecSum);
+    RegisterInterrupt("VecMin", VecMin);
+    RegisterInterrupt("VecMax", VecMax);
+    RegisterInterrupt("VecDot", VecDot);
+    RegisterInterrupt("VecAdd", VecAdd);
+    RegisterInterrupt("VecMul", VecMul);
+    RegisterInterrupt("VecAddScalar", VecAddScalar);
+    RegisterInterrupt("VecMulScalar", VecMulScalar);
+    RegisterInterrupt("VecPrefixSum", VecPrefixSum);
 }
 
 bool InterruptManager::RegisterInterrupt(const char *name, IntFunc func) {
@@ -205,7 +776,7 @@ bool InterruptManager::RegisterInterrupt(const char *name, IntFunc func) {
     return true;
 }
 
-bool InterruptManager::TriggerInterrupt(unsigned int id, std::array<Register, kRegisterCount> &reg, IntFuncMem mem) {
+bool InterruptManager::TriggerInterrupt(unsigned int id, std::array<Register, kRegisterCount> &reg, IntFuncMem mem, IntFuncIO io) {
     auto it = func_set_.find(id);
     if (it == func_set_.end()) return false;
 
@@ -213,7 +784,7 @@ bool InterruptManager::TriggerInterrupt(unsigned int id, std::array<Register, kR
     for (int i = 0; i < kArgRegisterCount; ++i) {
         arg[i] = reg[i + kArgRegisterOffset];
     }
-    ZValue ret = it->second(arg, mem);
+    ZValue ret = it->second(arg, mem, io);
     reg[kArgRegisterOffset + kArgRegisterCount] = ret.num;   // RV = ret
     return true;
 }
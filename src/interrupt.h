@@ -8,13 +8,18 @@
 
 #include "type.h"
 #include "memman.h"
+#include "ioman.h"
 
 namespace zvm {
 
 using IntFuncArg = const std::array<Register, kArgRegisterCount> &;
 using IntFuncMem = MemoryManager &;
-using IntFunc = std::function<ZValue(IntFuncArg, IntFuncMem)>;
+using IntFuncIO = IOManager &;
+using IntFunc = std::function<ZValue(IntFuncArg, IntFuncMem, IntFuncIO)>;
 
+// table of interrupts, it is not modified after construction, so it can
+// be shared by VMs running in different threads, interrupts must keep
+// their state in the memory or I/O manager of the VM
 class InterruptManager {
 public:
     InterruptManager();
@@ -22,7 +27,7 @@ public:
 
 
     bool RegisterInterrupt(const char *name, IntFunc func);
-    bool TriggerInterrupt(unsigned int id, std::array<Register, kRegisterCount> &reg, IntFuncMem mem);
+    bool TriggerInterrupt(unsigned int id, std::array<Register, kRegisterCount> &reg, IntFuncMem mem, IntFuncIO io);
 
 private:
     std::map<unsigned int, IntFunc> func_set_;
@@ -0,0 +1,203 @@
+#include "ioman.h"
+
+#include <charconv>
+#include <cctype>
+#include <cerrno>
+
+#include <unistd.h>
+
+namespace {
+
+const std::size_t kOutputBufferSize = 1024 * 64;
+const std::size_t kInputBufferSize = 1024 * 64;
+// longest result of "%lf" is about 310 characters (-DBL_MAX)
+const std::size_t kMaxNumberLength = 320;
+
+bool WriteAll(int fd, const char *data, std::size_t len) {
+    while (len) {
+        auto ret = write(fd, data, len);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+} // namespace
+
+namespace zvm {
+
+char *IOManager::Reserve(OutputChannel channel, std::size_t len) {
+    if (!out_buffer_) out_buffer_ = std::make_unique<char[]>(kOutputBufferSize);
+    if (out_fd_[channel] != buffer_fd_) {
+        Flush();
+        buffer_fd_ = out_fd_[channel];
+    }
+    if (out_pos_ + len > kOutputBufferSize) Flush();
+    return out_buffer_.get() + out_pos_;
+}
+
+void IOManager::Write(OutputChannel channel, const char *data, std::size_t len) {
+    if (len > kOutputBufferSize) {
+        // write large data directly
+        Reserve(channel, 0);
+        Flush();
+        WriteAll(buffer_fd_, data, len);
+        return;
+    }
+    memcpy(Reserve(channel, len), data, len);
+    out_pos_ += len;
+}
+
+void IOManager::WriteInteger(OutputChannel channel, long long value) {
+    auto pos = Reserve(channel, kMaxNumberLength);
+    auto ret = std::to_chars(pos, pos + kMaxNumberLength, value);
+    out_pos_ += ret.ptr - pos;
+}
+
+void IOManager::WriteFloat(OutputChannel channel, double value) {
+    auto pos = Reserve(channel, kMaxNumberLength);
+    auto ret = std::to_chars(pos, pos + kMaxNumberLength, value, std::chars_format::fixed, 6);
+    out_pos_ += ret.ptr - pos;
+}
+
+bool IOManager::Flush() {
+    if (!out_pos_) return true;
+    auto len = out_pos_;
+    out_pos_ = 0;
+    return WriteAll(buffer_fd_, out_buffer_.get(), len);
+}
+
+void IOManager::Reset() {
+    Flush();
+    ClearInput();
+    text_.clear();
+    async_.Clear();
+    for (const auto &fd : socket_list_) close(fd);
+    socket_list_.clear();
+    poller_.Close();
+    mailbox_cache_.clear();
+    if (mailbox_) {
+        Message message;
+        while (mailbox_->Receive(message));
+        mailbox_.reset();
+    }
+    suspend_ = false;
+}
+
+Mailbox *IOManager::FindMailbox(unsigned int id) {
+    auto it = mailbox_cache_.find(id);
+    if (it != mailbox_cache_.end()) return it->second.get();
+    auto mailbox = Mailbox::Find(id);
+    if (!mailbox) return nullptr;
+    return (mailbox_cache_[id] = std::move(mailbox)).get();
+}
+
+int IOManager::CloseSocket(int fd) {
+    poller_.Watch(fd, 0);
+    socket_list_.erase(fd);
+    return close(fd);
+}
+
+int IOManager::PeekChar() {
+    if (in_pos_ == in_end_) {
+        if (!in_buffer_) in_buffer_ = std::make_unique<char[]>(kInputBufferSize);
+        Flush();
+        in_pos_ = in_end_ = 0;
+        ssize_t ret;
+        do {
+            ret = read(in_fd_, in_buffer_.get(), kInputBufferSize);
+        } while (ret < 0 && errno == EINTR);
+        if (ret <= 0) return -1;
+        in_end_ = ret;
+    }
+    return (unsigned char)in_buffer_[in_pos_];
+}
+
+void IOManager::SkipSpace() {
+    int c;
+    while ((c = PeekChar()) >= 0 && isspace(c)) ++in_pos_;
+}
+
+template <typename Pred>
+const char *IOManager::ReadWhile(Pred pred, std::size_t &len) {
+    text_.clear();
+    while (PeekChar() >= 0) {
+        auto begin = in_buffer_.get() + in_pos_, end = in_buffer_.get() + in_end_;
+        auto pos = begin;
+        while (pos != end && pred(*pos)) ++pos;
+        in_pos_ += pos - begin;
+        if (pos != end && text_.empty()) {
+            // the whole text is in buffer
+            len = pos - begin;
+            return begin;
+        }
+        text_.append(begin, pos);
+        if (pos != end) break;
+    }
+    len = text_.size();
+    return text_.c_str();
+}
+
+int IOManager::ReadChar() {
+    auto c = PeekChar();
+    if (c >= 0) ++in_pos_;
+    return c;
+}
+
+bool IOManager::ReadInteger(long long &value) {
+    SkipSpace();
+    auto negative = false;
+    auto c = PeekChar();
+    if (c == '-' || c == '+') {
+        negative = c == '-';
+        ++in_pos_;
+    }
+    std::size_t len;
+    auto digits = ReadWhile([](char c) { return c >= '0' && c <= '9'; }, len);
+    if (!len) return false;
+    unsigned long long result = 0;
+    for (std::size_t i = 0; i < len; ++i) result = result * 10 + (digits[i] - '0');
+    value = negative ? -(long long)result : (long long)result;
+    return true;
+}
+
+bool IOManager::ReadFloat(double &value) {
+    SkipSpace();
+    std::size_t len;
+    auto text = ReadWhile([](char c) {
+        return (c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E'
+                || c == '-' || c == '+';
+    }, len);
+    // 'from_chars' does not accept a plus sign
+    if (len && *text == '+') {
+        ++text;
+        --len;
+    }
+    return std::from_chars(text, text + len, value).ec == std::errc();
+}
+
+const char *IOManager::ReadToken(std::size_t &len) {
+    SkipSpace();
+    if (PeekChar() < 0) return nullptr;
+    return ReadWhile([](char c) { return !isspace((unsigned char)c); }, len);
+}
+
+const char *IOManager::ReadLine(std::size_t &len) {
+    if (PeekChar() < 0) return nullptr;
+    auto line = ReadWhile([](char c) { return c != '\n'; }, len);
+    // there must be at least one character in buffer if the line is
+    // in buffer, so the line will not be overwritten
+    if (PeekChar() == '\n') ++in_pos_;
+    return line;
+}
+
+const char *IOManager::ReadAll(std::size_t &len) {
+    if (PeekChar() < 0) return nullptr;
+    return ReadWhile([](char c) { return true; }, len);
+}
+
+} // namespace zvm
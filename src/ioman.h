@@ -0,0 +1,114 @@
+#ifndef ZVM_IOMAN_H_
+#define ZVM_IOMAN_H_
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <unordered_map>
+#include <cstddef>
+#include <cstring>
+
+#include "asyncio.h"
+#include "netio.h"
+#include "mailbox.h"
+
+namespace zvm {
+
+// buffered I/O of a VM instance
+// all output channels share one buffer, which will be flushed when the
+// target changes, so the order of output is always kept
+class IOManager {
+public:
+    enum OutputChannel {
+        kPutChannel,   // 'Put*' interrupts, stderr by default
+        kAddChannel    // 'Add*' interrupts, stdout by default
+    };
+
+    IOManager()
+            : out_fd_{2, 1}, buffer_fd_(2), out_pos_(0),
+              in_fd_(0), in_pos_(0), in_end_(0), suspend_(false) {}
+    IOManager(const IOManager &) = delete;
+    IOManager &operator=(const IOManager &) = delete;
+    ~IOManager() { Reset(); }
+
+    void Write(OutputChannel channel, const char *data, std::size_t len);
+    void WriteChar(OutputChannel channel, char c) { *Reserve(channel, 1) = c; ++out_pos_; }
+    void WriteString(OutputChannel channel, const char *str) { Write(channel, str, strlen(str)); }
+    void WriteInteger(OutputChannel channel, long long value);
+    // same as "%lf" in printf
+    void WriteFloat(OutputChannel channel, double value);
+    // write all of the buffered data, return false if failed
+    bool Flush();
+
+    // output will be flushed before waiting for input
+    // return -1 if reached EOF
+    int ReadChar();
+    // same as "%lld" and "%lf" in scanf, return false if failed
+    bool ReadInteger(long long &value);
+    bool ReadFloat(double &value);
+    // read a word, a line (without '\n') or all the remaining input,
+    // return nullptr if reached EOF, otherwise the result is valid
+    // until next reading
+    const char *ReadToken(std::size_t &len);
+    const char *ReadLine(std::size_t &len);
+    const char *ReadAll(std::size_t &len);
+    // drop the buffered input
+    void ClearInput() { in_pos_ = in_end_ = 0; }
+    // flush output and drop the state of the last run: buffered input,
+    // asynchronous operations, sockets, watches and the mailbox
+    void Reset();
+
+    // sockets are closed when I/O manager is reset
+    void AddSocket(int fd) { socket_list_.insert(fd); }
+    // stop watching and close the socket, return the result of 'close'
+    int CloseSocket(int fd);
+
+    // ask VM to suspend after current instruction, the instruction
+    // will be executed again when VM resumes
+    void Suspend() { suspend_ = true; }
+    bool TakeSuspend() { auto ret = suspend_; suspend_ = false; return ret; }
+
+    void set_output_fd(OutputChannel channel, int fd) { out_fd_[channel] = fd; }
+    void set_input_fd(int fd) { in_fd_ = fd; }
+    AsyncIO &async() { return async_; }
+    net::Poller &poller() { return poller_; }
+    // mailbox 'id' that messages are sent to, return nullptr if there is
+    // no such mailbox, the result is cached so that sending does not look
+    // up the shared registry, until the mailbox is dropped or I/O manager
+    // is reset
+    Mailbox *FindMailbox(unsigned int id);
+    void DropMailbox(unsigned int id) { mailbox_cache_.erase(id); }
+
+    // mailbox that receives messages from other VMs, can be null
+    const std::shared_ptr<Mailbox> &mailbox() const { return mailbox_; }
+    void set_mailbox(std::shared_ptr<Mailbox> mailbox) { mailbox_ = std::move(mailbox); }
+
+private:
+    // make sure that there is enough space in buffer for channel
+    char *Reserve(OutputChannel channel, std::size_t len);
+    // read more data if input buffer is empty, return -1 if reached EOF
+    int PeekChar();
+    void SkipSpace();
+    // read characters that satisfy 'pred', in buffer if possible
+    template <typename Pred>
+    const char *ReadWhile(Pred pred, std::size_t &len);
+
+    int out_fd_[2], buffer_fd_;
+    std::unique_ptr<char[]> out_buffer_;
+    std::size_t out_pos_;
+    int in_fd_;
+    std::unique_ptr<char[]> in_buffer_;
+    std::size_t in_pos_, in_end_;
+    // for the text that across the boundary of input buffer
+    std::string text_;
+    AsyncIO async_;
+    net::Poller poller_;
+    std::unordered_set<int> socket_list_;
+    std::shared_ptr<Mailbox> mailbox_;
+    std::unordered_map<unsigned int, std::shared_ptr<Mailbox>> mailbox_cache_;
+    bool suspend_;
+};
+
+} // namespace zvm
+
+#endif // ZVM_IOMAN_H_
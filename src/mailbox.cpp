@@ -0,0 +1,149 @@
+#include "mailbox.h"
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+namespace {
+
+// mailboxes that can be found by id, they are owned by VMs or host
+class Registry {
+public:
+    std::shared_ptr<zvm::Mailbox> Create(unsigned int id) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto &entry = mailboxes_[id];
+        if (!entry.expired()) return nullptr;
+        auto mailbox = std::make_shared<zvm::Mailbox>(id);
+        entry = mailbox;
+        return mailbox;
+    }
+
+    std::shared_ptr<zvm::Mailbox> Find(unsigned int id) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = mailboxes_.find(id);
+        return it != mailboxes_.end() ? it->second.lock() : nullptr;
+    }
+
+    void Remove(unsigned int id) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = mailboxes_.find(id);
+        // the id may have been used by a new mailbox
+        if (it != mailboxes_.end() && it->second.expired()) mailboxes_.erase(it);
+    }
+
+private:
+    std::shared_mutex mutex_;
+    std::unordered_map<unsigned int, std::weak_ptr<zvm::Mailbox>> mailboxes_;
+};
+
+Registry &GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+} // namespace
+
+namespace zvm {
+
+Mailbox::Mailbox(unsigned int id)
+        : id_(id), slots_(std::make_unique<Slot[]>(kMailboxCapacity)),
+          event_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+          tail_(0), head_(0), waiting_(false) {
+    for (std::size_t i = 0; i < kMailboxCapacity; ++i) {
+        slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+Mailbox::~Mailbox() {
+    if (event_fd_ >= 0) close(event_fd_);
+    GetRegistry().Remove(id_);
+}
+
+std::shared_ptr<Mailbox> Mailbox::Create(unsigned int id) {
+    return GetRegistry().Create(id);
+}
+
+std::shared_ptr<Mailbox> Mailbox::Find(unsigned int id) {
+    return GetRegistry().Find(id);
+}
+
+bool Mailbox::Send(Message &message) {
+    // bounded queue by D. Vyukov, every slot has a sequence number
+    // that tells whether it is free or filled in current round
+    auto pos = tail_.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+        slot = &slots_[pos & (kMailboxCapacity - 1)];
+        auto seq = slot->seq.load(std::memory_order_acquire);
+        auto diff = (std::intptr_t)seq - (std::intptr_t)pos;
+        if (!diff) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (diff < 0) {
+            return false;
+        }
+        else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+    slot->message = std::move(message);
+    slot->seq.store(pos + 1, std::memory_order_release);
+    // pairs with the fence in 'Wait'
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed) && waiting_.exchange(false)) {
+        std::uint64_t value = 1;
+        while (write(event_fd_, &value, sizeof(value)) < 0 && errno == EINTR);
+    }
+    return true;
+}
+
+bool Mailbox::Receive(Message &message) {
+    auto &slot = slots_[head_ & (kMailboxCapacity - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != head_ + 1) return false;
+    message = std::move(slot.message);
+    slot.message.data.clear();
+    slot.seq.store(head_ + kMailboxCapacity, std::memory_order_release);
+    ++head_;
+    return true;
+}
+
+bool Mailbox::empty() const {
+    auto &slot = slots_[head_ & (kMailboxCapacity - 1)];
+    return slot.seq.load(std::memory_order_acquire) != head_ + 1;
+}
+
+bool Mailbox::Wait(int timeout) {
+    using Clock = std::chrono::steady_clock;
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeout);
+    while (empty()) {
+        auto remaining = timeout;
+        if (timeout > 0) {
+            remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - Clock::now()).count();
+            if (remaining < 0) remaining = 0;
+        }
+        if (!remaining || event_fd_ < 0) return false;
+        waiting_.store(true, std::memory_order_relaxed);
+        // a sender either sees 'waiting_' or its message is seen here
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (empty()) {
+            pollfd pfd = {event_fd_, POLLIN, 0};
+            while (poll(&pfd, 1, remaining) < 0 && errno == EINTR);
+        }
+        waiting_.store(false, std::memory_order_relaxed);
+        // the notification may be left by an earlier sender,
+        // so check the queue again
+        std::uint64_t value;
+        while (read(event_fd_, &value, sizeof(value)) < 0 && errno == EINTR);
+    }
+    return true;
+}
+
+} // namespace zvm
@@ -0,0 +1,71 @@
+#ifndef ZVM_MAILBOX_H_
+#define ZVM_MAILBOX_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstddef>
+
+namespace zvm {
+
+// number of messages that a mailbox can hold, must be a power of 2
+const std::size_t kMailboxCapacity = 1024;
+
+// message between VM instances, content of the object is copied
+struct Message {
+    unsigned int type;     // 0 for String, otherwise type of Buffer
+    unsigned int length;   // number of elements of Buffer
+    std::string data;
+};
+
+// bounded multi-producer single-consumer queue of messages, any thread
+// can send messages to it, but only the VM that owns it can receive
+// sending and receiving are lock-free, a system call is only made when
+// the receiver is waiting
+class Mailbox {
+public:
+    explicit Mailbox(unsigned int id);
+    Mailbox(const Mailbox &) = delete;
+    Mailbox &operator=(const Mailbox &) = delete;
+    ~Mailbox();
+
+    // register a mailbox with 'id' so that other VMs can find it,
+    // return nullptr if 'id' is already used
+    static std::shared_ptr<Mailbox> Create(unsigned int id);
+    // return nullptr if there is no such mailbox
+    // this takes a lock of the registry, so senders should keep
+    // the mailbox instead of finding it for every message
+    static std::shared_ptr<Mailbox> Find(unsigned int id);
+
+    // return false if the mailbox is full
+    bool Send(Message &message);
+    // return false if the mailbox is empty, consumer only
+    bool Receive(Message &message);
+    // wait until there is a message or timeout (in milliseconds, -1
+    // means forever), return false if there is still no message
+    // consumer only
+    bool Wait(int timeout);
+
+    unsigned int id() const { return id_; }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> seq;
+        Message message;
+    };
+
+    bool empty() const;
+
+    unsigned int id_;
+    std::unique_ptr<Slot[]> slots_;
+    // eventfd that wakes the waiting receiver
+    int event_fd_;
+    // keep producers and consumer in different cache lines
+    alignas(64) std::atomic<std::size_t> tail_;
+    alignas(64) std::size_t head_;
+    std::atomic<bool> waiting_;
+};
+
+} // namespace zvm
+
+#endif // ZVM_MAILBOX_H_
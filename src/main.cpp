@@ -1,14 +1,26 @@
-#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <cstring>
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <utility>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "type.h"
 #include "interrupt.h"
 #include "zvm.h"
+#include "vmpool.h"
 #include "xstl/argh.h"
 
 using namespace zvm;
@@ -24,8 +36,13 @@ void PrintMessage(const std::string &str, int msg_code = 0) {
 void PrintHelp() {
     std::cout << "usage: zvm [options] <inputs>" << std::endl;
     std::cout << "options:" << std::endl;
-    std::cout << "  -g --gc-pool <value>\t\tSet the pool size of garbage collector" << std::endl;
+    std::cout << "  -g --gc-pool <value>\t\tSet the pool size of garbage collector (suffix K, M, G)" << std::endl;
     std::cout << "  -a --args <value>\t\tSpecify startup arguments of a ZexVM program" << std::endl;
+    std::cout << "  -s --snapshot-at <pc>\t\tStop at PC and save the state to an image" << std::endl;
+    std::cout << "  -o --output <file>\t\tSpecify the image file (default: <input>.zimg)" << std::endl;
+    std::cout << "  -r --restore <file>\t\tRestore from an image and continue running" << std::endl;
+    std::cout << "  -f --fd <value>\t\tWrite all output of program to a file descriptor" << std::endl;
+    std::cout << "  -j --jobs <value>\t\tRun programs listed in input by threads (0: all cores)" << std::endl;
     std::cout << std::endl;
     std::cout << "  -h --help\t\t\tDisplay this help information" << std::endl;
     std::cout << "  -v --version\t\t\tDisplay zasm version information" << std::endl;
@@ -34,6 +51,16 @@ void PrintHelp() {
     std::cout << "\033[1mhttps://github.com/MaxXSoft/ZexVM/issues\033[0m" << std::endl;
 }
 
+// run until program stops, wait for the asynchronous operations
+// each time the program is suspended
+int RunProgram(ZexVM &vm, long long break_pc) {
+    auto ret_val = break_pc < 0 ? vm.Run() : vm.RunUntil(break_pc);
+    while (ret_val == kSuspended && vm.io().async().Wait()) {
+        ret_val = break_pc < 0 ? vm.Run() : vm.RunUntil(break_pc);
+    }
+    return ret_val;
+}
+
 void PrintVersion() {
     std::cout << "Zexium Virtual Machine (aka. ZexVM or ZVM) version ";
     std::cout << std::setfill('0') << std::setw(3);
@@ -44,6 +71,31 @@ void PrintVersion() {
     std::cout << "\033[1mhttps://github.com/MaxXSoft/ZexVM\033[0m" << std::endl;
 }
 
+// non-zero size with an optional suffix 'K', 'M' or 'G'
+bool GetSize(const std::string &v, PoolSizeT &size) {
+    std::size_t pos;
+    try {
+        size = std::stoull(v, &pos);
+    }
+    catch (...) {
+        return false;
+    }
+    if (!size) return false;
+    if (pos == v.size()) return true;
+    if (pos + 1 != v.size()) return false;
+    int shift;
+    switch (v[pos]) {
+        case 'k': case 'K': shift = 10; break;
+        case 'm': case 'M': shift = 20; break;
+        case 'g': case 'G': shift = 30; break;
+        default: return false;
+    }
+    // the size must not overflow after shifting
+    if (size > ((PoolSizeT)-1 >> shift)) return false;
+    size <<= shift;
+    return true;
+}
+
 void GetArgList(std::vector<std::string> &arg_list, const std::string &v) {
     std::string temp;
     bool in_quote = false;
@@ -66,13 +118,141 @@ void GetArgList(std::vector<std::string> &arg_list, const std::string &v) {
     if (!temp.empty()) arg_list.push_back(std::move(temp));
 }
 
+// a line of job list: <program> [arguments]
+struct Job {
+    std::string path;
+    std::vector<std::string> arg_list;
+};
+
+bool ReadJobList(const std::string &path, std::vector<Job> &job_list) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        auto pos = line.find_first_not_of(" \t");
+        // skip empty lines and comments
+        if (pos == std::string::npos || line[pos] == '#') continue;
+        std::vector<std::string> words;
+        GetArgList(words, line);
+        if (words.empty()) continue;
+        Job job;
+        job.path = std::move(words.front());
+        job.arg_list.assign(words.begin() + 1, words.end());
+        job_list.push_back(std::move(job));
+    }
+    return true;
+}
+
+// read all the output that has been written to a memory file
+std::string ReadOutput(int fd) {
+    std::string output;
+    char buffer[4096];
+    ssize_t len;
+    lseek(fd, 0, SEEK_SET);
+    while ((len = read(fd, buffer, sizeof(buffer))) > 0) output.append(buffer, len);
+    return output;
+}
+
+// run jobs by a pool of threads, VM instances are taken from the pool
+// of the program and reset after each job, its output is printed
+// after it finished
+// return the number of failed jobs
+int RunBatch(const std::vector<Job> &job_list, unsigned int thread_count,
+             PoolSizeT gc_pool_size, InterruptManager &int_manager) {
+    using Clock = std::chrono::steady_clock;
+    auto GetMillisecond = [](Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+
+    // programs are loaded once, jobs of the same program share a pool
+    std::map<std::string, std::unique_ptr<VMPool>> pools;
+    for (const auto &i : job_list) {
+        if (pools.count(i.path)) continue;
+        auto program = Program::Load(i.path.c_str());
+        auto &pool = pools[i.path];
+        if (program) pool = std::make_unique<VMPool>(program, int_manager, gc_pool_size);
+    }
+    // workers only look up pools, the map itself is never modified
+    const auto pool_list = std::move(pools);
+    // job 'i' receives messages by mailbox 'i', all mailboxes are created
+    // before running so that messages can be sent to jobs not started yet
+    std::vector<std::shared_ptr<Mailbox>> mailbox_list;
+    for (std::size_t i = 0; i < job_list.size(); ++i) {
+        mailbox_list.push_back(Mailbox::Create(i));
+    }
+    // jobs should not race for the standard input
+    auto null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    std::atomic<std::size_t> next_job(0);
+    std::atomic<int> failed_count(0);
+    std::atomic<long long> total_time(0);
+    std::mutex print_mutex;
+
+    auto RunJobs = [&] {
+        for (;;) {
+            auto index = next_job++;
+            if (index >= job_list.size()) break;
+            const auto &job = job_list[index];
+            auto output_fd = memfd_create("zvm-job", MFD_CLOEXEC);
+            auto begin = Clock::now();
+            std::string result = "program error";
+            const auto &pool = pool_list.at(job.path);
+            auto vm = pool ? pool->Acquire() : nullptr;
+            if (vm) {
+                if (output_fd >= 0) {
+                    vm->io().set_output_fd(IOManager::kPutChannel, output_fd);
+                    vm->io().set_output_fd(IOManager::kAddChannel, output_fd);
+                }
+                vm->io().set_input_fd(null_fd);
+                vm->io().set_mailbox(mailbox_list[index]);
+                if (vm->SetStartupArguments(job.arg_list)) {
+                    auto ret_val = RunProgram(*vm, -1);
+                    result = ret_val == kFinished ? "success" : "runtime error " + std::to_string(ret_val);
+                }
+                vm->io().Flush();
+            }
+            auto elapsed = Clock::now() - begin;
+            // reset and reuse the instance in the following jobs
+            if (vm) pool->Release(std::move(vm));
+            if (result != "success") ++failed_count;
+            total_time += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+            auto output = output_fd >= 0 ? ReadOutput(output_fd) : std::string();
+            if (output_fd >= 0) close(output_fd);
+
+            std::lock_guard<std::mutex> lock(print_mutex);
+            std::cout << "[job " << index << "] " << job.path << ": " << result << ", ";
+            std::cout << std::fixed << std::setprecision(3) << GetMillisecond(elapsed) << " ms" << std::endl;
+            std::cout << output;
+            if (!output.empty() && output.back() != '\n') std::cout << std::endl;
+        }
+    };
+
+    auto begin = Clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < thread_count; ++i) threads.emplace_back(RunJobs);
+    RunJobs();
+    for (auto &&i : threads) i.join();
+    auto elapsed = Clock::now() - begin;
+    if (null_fd >= 0) close(null_fd);
+
+    std::cout << std::endl << "jobs: " << job_list.size() << ", failed: " << failed_count;
+    std::cout << ", threads: " << thread_count << std::endl;
+    std::cout << std::fixed << std::setprecision(3) << "wall time: " << GetMillisecond(elapsed);
+    std::cout << " ms, total time of jobs: " << total_time / 1e6 << " ms" << std::endl;
+    return failed_count;
+}
+
 } // namespace
 
 int main(int argc, const char *argv[]) {
     xstl::ArgumentHandler argh;
-    std::ifstream in;
+    std::string path;
     std::vector<std::string> arg_list;
-    MemSizeT gc_pool_size = kGCPoolSize;
+    std::string image_path, restore_path;
+    PoolSizeT gc_pool_size = kGCPoolSize;
+    long long break_pc = -1;
+    int output_fd = -1;
+    int thread_count = -1;
 
     auto PrintError = [](xstl::StrRef v) {
         std::cout << "invalid command ";
@@ -89,10 +269,7 @@ int main(int argc, const char *argv[]) {
     argh.AddHandler("v", [](xstl::StrRef v) { PrintVersion(); return 1; });
     argh.AddAlias("version", "v");
     argh.AddHandler("g", [&gc_pool_size](xstl::StrRef v) {
-        try {
-            gc_pool_size = std::stoi(v);
-        }
-        catch (...) {
+        if (!GetSize(v, gc_pool_size)) {
             std::cout << "invalid pool size" << std::endl;
             return 1;
         }
@@ -104,22 +281,111 @@ int main(int argc, const char *argv[]) {
         return 0;
     });
     argh.AddAlias("args", "a");
-    argh.AddHandler("", [&in](xstl::StrRef v) {
-        in.open(v, std::ios_base::binary);
+    argh.AddHandler("s", [&break_pc](xstl::StrRef v) {
+        try {
+            break_pc = std::stoll(v, nullptr, 0);
+        }
+        catch (...) {
+            std::cout << "invalid PC" << std::endl;
+            return 1;
+        }
+        return 0;
+    });
+    argh.AddAlias("snapshot-at", "s");
+    argh.AddHandler("o", [&image_path](xstl::StrRef v) {
+        image_path = v;
+        return 0;
+    });
+    argh.AddAlias("output", "o");
+    argh.AddHandler("r", [&restore_path](xstl::StrRef v) {
+        restore_path = v;
+        return 0;
+    });
+    argh.AddAlias("restore", "r");
+    argh.AddHandler("f", [&output_fd](xstl::StrRef v) {
+        try {
+            output_fd = std::stoi(v);
+        }
+        catch (...) {
+            output_fd = -1;
+        }
+        if (output_fd < 0) {
+            std::cout << "invalid file descriptor" << std::endl;
+            return 1;
+        }
+        return 0;
+    });
+    argh.AddAlias("fd", "f");
+    argh.AddHandler("j", [&thread_count](xstl::StrRef v) {
+        try {
+            thread_count = std::stoi(v);
+        }
+        catch (...) {
+            thread_count = -1;
+        }
+        if (thread_count < 0) {
+            std::cout << "invalid number of threads" << std::endl;
+            return 1;
+        }
+        return 0;
+    });
+    argh.AddAlias("jobs", "j");
+    argh.AddHandler("", [&path](xstl::StrRef v) {
+        path = v;
         return 0;
     });
 
     if (!argh.ParseArguments(argc, argv)) return 0;
 
     InterruptManager int_manager;
+    if (thread_count >= 0) {
+        // batch mode, input is a list of jobs
+        std::vector<Job> job_list;
+        if (!ReadJobList(path, job_list)) {
+            PrintMessage("invalid job list");
+            return 1;
+        }
+        if (!thread_count) thread_count = std::max(1U, std::thread::hardware_concurrency());
+        return RunBatch(job_list, thread_count, gc_pool_size, int_manager) ? 1 : 0;
+    }
+
     ZexVM vm(gc_pool_size, int_manager);
+    vm.io().set_mailbox(Mailbox::Create(0));
+    if (output_fd >= 0) {
+        vm.io().set_output_fd(IOManager::kPutChannel, output_fd);
+        vm.io().set_output_fd(IOManager::kAddChannel, output_fd);
+    }
 
-    if (vm.LoadProgram(in)) {
+    if (!restore_path.empty()) {
+        // startup arguments are already in the image
+        if (vm.LoadSnapshot(restore_path.c_str())) {
+            auto ret_val = RunProgram(vm, -1);
+            if(ret_val == kFinished) {
+                PrintMessage("success!");
+            }
+            else {
+                PrintMessage("runtime error. return: ", ret_val);
+            }
+        }
+        else {
+            PrintMessage("image error");
+        }
+    }
+    else if (vm.LoadProgram(path.c_str())) {
         vm.SetStartupArguments(arg_list);
-        auto ret_val = vm.Run();
+        auto ret_val = RunProgram(vm, break_pc);
         if(ret_val == kFinished) {
             PrintMessage("success!");
         }
+        else if (ret_val == kBreakpoint) {
+            if (image_path.empty()) image_path = path + ".zimg";
+            if (vm.SaveSnapshot(image_path.c_str())) {
+                PrintMessage("snapshot saved: " + image_path);
+            }
+            else {
+                PrintMessage("snapshot error");
+            }
+        }
         else {
             PrintMessage("runtime error. return: ", ret_val);
         }
@@ -1,17 +1,178 @@
 #include "memman.h"
 
 #include <cstring>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "strfunc.h"
+#include "vecfunc.h"
+
+namespace {
+
+// size of each type of buffer element, 0 means invalid type
+const zvm::MemSizeT kBufferElemSize[] = {
+    0, sizeof(unsigned char), sizeof(int), sizeof(long long),
+    sizeof(float), sizeof(double)
+};
+
+inline zvm::MemSizeT GetElemSize(unsigned int type) {
+    return type <= zvm::kBufferF64 ? kBufferElemSize[type] : 0;
+}
+
+// layout of Map object: MapHeader, MapSlot[capacity]
+struct MapHeader {
+    unsigned int key_type;
+    zvm::MemSizeT count, capacity;
+    zvm::MemSizeT used;   // including deleted slots
+};
+
+enum MapSlotState : unsigned int {
+    kSlotEmpty, kSlotUsed, kSlotDeleted
+};
+
+struct MapSlot {
+    unsigned int state;
+    unsigned int hash;   // cached hash of key
+    zvm::Register key, value;
+};
+
+const zvm::MemSizeT kMapInitCapacity = 8;
+
+inline MapSlot *GetMapSlots(MapHeader *header) {
+    return (MapSlot *)(header + 1);
+}
+
+inline zvm::MemSizeT GetMapObjSize(zvm::MemSizeT capacity) {
+    return sizeof(MapHeader) + capacity * sizeof(MapSlot);
+}
+
+inline bool IsMapFull(const MapHeader *header) {
+    // load factor is 0.75
+    return (header->used + 1) * 4 > header->capacity * 3;
+}
+
+inline unsigned int HashInteger(long long value) {
+    // finalizer of MurmurHash3
+    auto x = (unsigned long long)value;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (unsigned int)x;
+}
+
+// information of key used to look up a Map
+struct MapKey {
+    zvm::Register key;
+    unsigned int hash;
+    const char *str;   // nullptr if key is an integer
+    zvm::MemSizeT len;
+};
+
+// find the slot of key, if not found, return the slot to insert
+MapSlot *FindMapSlot(MapHeader *header, const MapKey &key, zvm::GarbageCollector &gc, bool &found) {
+    auto slots = GetMapSlots(header);
+    auto mask = header->capacity - 1;
+    MapSlot *deleted = nullptr;
+    for (auto i = key.hash & mask; ; i = (i + 1) & mask) {
+        auto &slot = slots[i];
+        if (slot.state == kSlotEmpty) {
+            found = false;
+            return deleted ? deleted : &slot;
+        }
+        else if (slot.state == kSlotDeleted) {
+            if (!deleted) deleted = &slot;
+        }
+        else if (slot.hash == key.hash) {
+            if (!key.str) {
+                found = slot.key.long_long == key.key.long_long;
+            }
+            else {
+                zvm::ZValue slot_key = {slot.key};
+                zvm::MemSizeT len;
+                auto str = gc.AccessObj(slot_key.str.position, len);
+                found = str && len - 1 == key.len && !memcmp(str, key.str, key.len);
+            }
+            if (found) return &slot;
+        }
+    }
+}
+
+// get the information of key, string key will be hashed
+bool MakeMapKey(zvm::MemoryManager &mem, unsigned int key_type, zvm::Register key, MapKey &map_key) {
+    map_key = {key, 0, nullptr, 0};
+    if (key_type == zvm::kMapKeyString) {
+        zvm::ZValue str_key = {key};
+        map_key.str = mem.GetRawString(str_key.str, map_key.len);
+        if (!map_key.str) return false;
+        map_key.hash = mem.StringHash(str_key.str);
+    }
+    else {
+        map_key.hash = HashInteger(key.long_long);
+    }
+    return true;
+}
+
+// string item used in sorting and searching
+struct StringItem {
+    const char *str;
+    zvm::MemSizeT len;
+    zvm::Register value;
+};
+
+inline bool StringItemLess(const StringItem &item1, const StringItem &item2) {
+    auto ret = memcmp(item1.str, item2.str, std::min(item1.len, item2.len));
+    return ret < 0 || (!ret && item1.len < item2.len);
+}
+
+} // namespace
 
 namespace zvm {
 
 void MemoryManager::ResetMemory() {
-    mem_ = std::make_unique<char[]>(mem_size_);
-    stack_ = std::make_unique<char[]>(stack_size_);
     stack_ptr_ = 0;
-    mem_error_ = false;
+    mem_error_ = !mem_.Allocate(mem_size_) || !stack_.Allocate(stack_size_);
     if (gc_.gc_error()) gc_.ResetGC();   // TODO: ???
 }
 
+void MemoryManager::RestoreMemory(const char *image, MemSizeT image_size) {
+    mem_.Restore(image, image_size);
+    stack_.Restore(nullptr, 0);
+    stack_ptr_ = 0;
+    mem_error_ = false;
+    gc_.ResetGC();
+    if (gc_.gc_error()) mem_error_ = true;
+}
+
+bool MemoryManager::SaveState(snapshot::ImageWriter &writer, snapshot::ImageHeader &header) {
+    header.mem_size = mem_size_;
+    header.stack_size = stack_size_;
+    header.stack_ptr = stack_ptr_;
+    // save the whole pages, so they can be mapped when loading
+    header.mem_offset = writer.WriteSection(mem_.pages(), mem_.pages_size());
+    header.stack_offset = writer.WriteSection(stack_.pages(), stack_.pages_size());
+    return gc_.SaveState(writer, header);
+}
+
+bool MemoryManager::LoadState(const snapshot::ImageReader &reader) {
+    const auto &header = reader.header();
+    mem_size_ = header.mem_size;
+    stack_size_ = header.stack_size;
+    // image of constant pool is set by VM after loading
+    set_const_pool(nullptr, header.const_pool_size);
+    ResetMemory();
+    if (mem_error_) return false;
+    if (!reader.MapSection(mem_.pages(), header.mem_offset, mem_.pages_size())
+            || !reader.MapSection(stack_.pages(), header.stack_offset, stack_.pages_size())) {
+        return !(mem_error_ = true);
+    }
+    mem_.MarkMapped();
+    stack_.MarkMapped();
+    stack_ptr_ = header.stack_ptr;
+    if (!gc_.LoadState(reader)) return !(mem_error_ = true);
+    return true;
+}
+
 String MemoryManager::AddStringObj(MemSizeT position) {
     auto ReturnError = [this]() {
         mem_error_ = true;
@@ -19,8 +180,18 @@ String MemoryManager::AddStringObj(MemSizeT position) {
         return str;
     };
     if (position >= mem_size_) return ReturnError();
-    auto len = strlen(mem_.get() + position) + 1;   // with '\0'
-    auto id = gc_.AddObjFromMemory(mem_.get() + position, len);
+    auto data = mem_.get() + position;
+    auto len = strlen(data) + 1;   // with '\0'
+    unsigned int id;
+    if (const_pool_ && position + len <= const_pool_size_
+            && !memcmp(data, const_pool_ + position, len)) {
+        // constant strings are shared by interning, but constant pool
+        // is writable, so modified ones are ordinary strings
+        id = gc_.AddInternedObj(data, len, strfunc::Hash(data, len - 1));
+    }
+    else {
+        id = gc_.AddObjFromMemory(data, len);
+    }
     if (gc_.gc_error()) return ReturnError();
     return {0, id};
 }
@@ -34,6 +205,40 @@ String MemoryManager::AddStringObj(const std::string &str) {
     return {0, id};
 }
 
+String MemoryManager::AddStringObj(const char *data, MemSizeT length) {
+    auto id = gc_.AddObj(length + 1);
+    if (gc_.gc_error()) {
+        mem_error_ = true;
+        return {0, 0};
+    }
+    auto obj = gc_.AccessObj(id);
+    memcpy(obj, data, length);
+    obj[length] = '\0';
+    return {0, id};
+}
+
+String MemoryManager::AllocStringObj(MemSizeT length, char *&data) {
+    auto id = gc_.AddObj(length + 1);
+    if (gc_.gc_error()) {
+        mem_error_ = true;
+        data = nullptr;
+        return {0, 0};
+    }
+    data = gc_.AccessObj(id);
+    data[length] = '\0';
+    return {0, id};
+}
+
+bool MemoryManager::MapFileString(const char *path, String &str) {
+    std::size_t size;
+    auto data = vmem::MapFileZeroEnded(path, size);
+    if (!data) return false;
+    auto id = gc_.AddFileObj(data, size);
+    if (gc_.gc_error()) return !(mem_error_ = true);
+    str = {0, id};
+    return true;
+}
+
 List MemoryManager::AddListObj(MemSizeT position, MemSizeT length) {
     auto ReturnError = [this]() {
         mem_error_ = true;
@@ -43,6 +248,7 @@ List MemoryManager::AddListObj(MemSizeT position, MemSizeT length) {
     if (position + length * sizeof(Register) >= mem_size_) return ReturnError();
     auto id = gc_.AddObjFromMemory(mem_.get() + position, length * sizeof(Register));
     if (gc_.gc_error()) return ReturnError();
+    gc_.SetContainer(id);
     return {0, id};
 }
 
@@ -52,9 +258,27 @@ List MemoryManager::AddListObj(const ZValue *data, MemSizeT length) {
         mem_error_ = true;
         return {0, 0};
     }
+    gc_.SetContainer(id);
     return {0, id};
 }
 
+Buffer MemoryManager::AddBufferObj(unsigned int type, MemSizeT length) {
+    auto elem_size = GetElemSize(type);
+    // size of buffer in bytes must also fit in MemSizeT
+    if (!elem_size || length > (MemSizeT)-1 / elem_size) {
+        mem_error_ = true;
+        return {0, 0};
+    }
+    auto id = gc_.AddObj(length * elem_size);
+    if (gc_.gc_error()) {
+        mem_error_ = true;
+        return {0, 0};
+    }
+    // GC pool may be dirty
+    memset(gc_.AccessObj(id), 0, length * elem_size);
+    return {type, id};
+}
+
 bool MemoryManager::DelStringObj(String str) {
     return gc_.DeleteObj(str.position);
 }
@@ -69,10 +293,46 @@ const char *MemoryManager::GetRawString(String str) {
     return obj;
 }
 
+const char *MemoryManager::GetRawString(String str, MemSizeT &length) {
+    MemSizeT obj_len;
+    auto obj = gc_.AccessObj(str.position, obj_len);
+    if (!obj) {
+        mem_error_ = true;
+        return nullptr;
+    }
+    length = obj_len - 1;   // without '\0'
+    return obj;
+}
+
 bool MemoryManager::SetRawString(String &str, const char *data) {
-    gc_.DeleteObj(str.position);
-    gc_.AddObjFromMemory(data, strlen(data) + 1);
-    if (gc_.gc_error()) return !(mem_error_ = true);
+    return SetRawString(str, data, strlen(data));
+}
+
+bool MemoryManager::SetRawString(String &str, const char *data, MemSizeT length) {
+    MemSizeT obj_len;
+    auto obj = gc_.AccessObj(str.position, obj_len);
+    if (!obj) return !(mem_error_ = true);
+    // rewrite in place if the length does not change
+    // interned string is immutable, so it must be copied
+    if (obj_len != length + 1 || gc_.IsImmutable(str.position)) {
+        // immutable object may be referenced by others
+        if (!gc_.IsImmutable(str.position)) gc_.DeleteObj(str.position);
+        auto id = gc_.AddObj(length + 1);
+        if (gc_.gc_error()) return !(mem_error_ = true);
+        str.position = id;
+        obj = gc_.AccessObj(id);
+    }
+    else {
+        gc_.ClearObjHash(str.position);
+    }
+    memcpy(obj, data, length);
+    obj[length] = '\0';
+    return true;
+}
+
+bool MemoryManager::TruncateString(String str, MemSizeT length) {
+    if (!gc_.ShrinkObj(str.position, length + 1)) return !(mem_error_ = true);
+    gc_.AccessObj(str.position)[length] = '\0';
     return true;
 }
 
@@ -121,14 +381,30 @@ void MemoryManager::DelListRef(List list, List ref) {
 }
 
 bool MemoryManager::StringCompare(String str1, String str2) {
-    auto obj1 = gc_.AccessObj(str1.position);
-    auto obj2 = gc_.AccessObj(str2.position);
-    return !strcmp(obj1, obj2);
+    MemSizeT len1, len2;
+    auto obj1 = gc_.AccessObj(str1.position, len1);
+    auto obj2 = gc_.AccessObj(str2.position, len2);
+    if (!obj1 || !obj2) return !(mem_error_ = true);
+    // compare the length first
+    if (len1 != len2) return false;
+    if (obj1 == obj2) return true;
+    // interned strings are unique
+    if (gc_.IsInterned(str1.position) && gc_.IsInterned(str2.position)) return false;
+    // then compare the hash, which will be cached
+    if (StringHash(str1) != StringHash(str2)) return false;
+    return !memcmp(obj1, obj2, len1);
 }
 
-bool MemoryManager::StringCatenate(String str1, String str2) {
+bool MemoryManager::StringCatenate(String &str1, String str2) {
     auto obj2 = gc_.AccessObj(str2.position);
     if (!obj2) return !(mem_error_ = true);
+    // interned string and mapped file are immutable
+    if (gc_.IsImmutable(str1.position)) {
+        str1 = StringCopy(str1);
+        if (mem_error_) return false;
+        obj2 = gc_.AccessObj(str2.position);
+        if (!obj2) return !(mem_error_ = true);
+    }
     auto data_len = StringLength(str2) + 1;
     if (mem_error_) return false;
     if (!gc_.ExpandObj(str1.position, obj2, data_len, 1)) return !(mem_error_ = true);
@@ -141,25 +417,338 @@ MemSizeT MemoryManager::StringLength(String str) {
     return temp;
 }
 
+unsigned int MemoryManager::StringHash(String str) {
+    unsigned int hash;
+    if (gc_.GetObjHash(str.position, hash)) return hash;
+    MemSizeT len;
+    auto obj = GetRawString(str, len);
+    if (!obj) return 0;
+    hash = strfunc::Hash(obj, len);
+    gc_.SetObjHash(str.position, hash);
+    return hash;
+}
+
 String MemoryManager::StringCopy(String str) {
     auto ReturnError = [this]() {
         mem_error_ = true;
         String str = {0, 0};
         return str;
     };
-    auto obj = gc_.AccessObj(str.position);
+    MemSizeT len;
+    auto obj = gc_.AccessObj(str.position, len);
     if (!obj) return ReturnError();
-    auto len = StringLength(str);
-    if (mem_error_) return ReturnError();
-    auto id = gc_.AddObj(len + 1);
+    auto id = gc_.AddObjFromMemory(obj, len);
     if (gc_.gc_error()) return ReturnError();
-    auto new_obj = gc_.AccessObj(id);
-    for (MemSizeT i = 0; i < len + 1; ++i) {
-        new_obj[i] = obj[i];
+    return {0, id};
+}
+
+long long MemoryManager::StringFind(String str, String sub) {
+    MemSizeT len, sub_len;
+    auto obj = gc_.AccessObj(str.position, len);
+    auto sub_obj = gc_.AccessObj(sub.position, sub_len);
+    if (!obj || !sub_obj) {
+        mem_error_ = true;
+        return -1;
+    }
+    return strfunc::Find(obj, len - 1, sub_obj, sub_len - 1);
+}
+
+long long MemoryManager::StringFind(String str, char c) {
+    MemSizeT len;
+    auto obj = gc_.AccessObj(str.position, len);
+    if (!obj) {
+        mem_error_ = true;
+        return -1;
     }
+    return strfunc::Find(obj, len - 1, c);
+}
+
+List MemoryManager::StringSplit(String str, String delim) {
+    MemSizeT len;
+    auto obj = gc_.AccessObj(delim.position, len);
+    if (!obj) {
+        mem_error_ = true;
+        return {0, 0};
+    }
+    // full GC may move the delimiter, so make a copy
+    std::string temp(obj, len - 1);
+    return SplitString(str, temp.c_str(), temp.length());
+}
+
+List MemoryManager::StringSplit(String str, char delim) {
+    return SplitString(str, &delim, 1);
+}
+
+List MemoryManager::SplitString(String str, const char *delim, MemSizeT delim_len) {
+    auto ReturnError = [this]() {
+        mem_error_ = true;
+        List list = {0, 0};
+        return list;
+    };
+    MemSizeT len;
+    auto obj = gc_.AccessObj(str.position, len);
+    if (!obj || !delim_len) return ReturnError();
+    std::string data(obj, len - 1);
+
+    // find all of the pieces before allocating anything
+    std::vector<std::pair<MemSizeT, MemSizeT>> pieces;   // <start, length>
+    MemSizeT total_len = 0, cur = 0;
+    for (;;) {
+        auto pos = strfunc::Find(data.data() + cur, data.length() - cur, delim, delim_len);
+        MemSizeT end = pos < 0 ? data.length() : cur + pos;
+        pieces.push_back({cur, end - cur});
+        total_len += end - cur + 1;
+        if (pos < 0) break;
+        cur = end + delim_len;
+    }
+    total_len += pieces.size() * sizeof(Register);
+
+    // pieces are unreachable before they are added to the list,
+    // so full GC must not be triggered during the allocation
+    if (!gc_.Reserve(total_len)) return ReturnError();
+    auto items = std::make_unique<ZValue[]>(pieces.size());
+    for (MemSizeT i = 0; i < pieces.size(); ++i) {
+        const auto &piece = pieces[i];
+        data[piece.first + piece.second] = '\0';
+        auto id = gc_.AddObjFromMemory(data.data() + piece.first, piece.second + 1);
+        if (gc_.gc_error()) return ReturnError();
+        items[i].str = {0, id};
+    }
+    auto list = AddListObj(items.get(), pieces.size());
+    if (mem_error_) return list;
+    for (MemSizeT i = 0; i < pieces.size(); ++i) {
+        // depends on the similarity of List and String
+        AddListRef(list, items[i].list);
+    }
+    return list;
+}
+
+char *MemoryManager::AccessBufferObj(Buffer buf, MemSizeT &length, MemSizeT &elem_size) {
+    elem_size = GetElemSize(buf.type);
+    auto obj = gc_.AccessObj(buf.position, length);
+    if (!obj || !elem_size) {
+        mem_error_ = true;
+        return nullptr;
+    }
+    length /= elem_size;
+    return obj;
+}
+
+Register MemoryManager::GetBufferItem(Buffer buf, MemSizeT index) {
+    MemSizeT len, elem_size;
+    auto obj = AccessBufferObj(buf, len, elem_size);
+    Register value = {0};
+    if (!obj || index >= len) {
+        mem_error_ = true;
+        return value;
+    }
+    switch (buf.type) {
+        case kBufferU8: value.long_long = ((unsigned char *)obj)[index]; break;
+        case kBufferI32: value.long_long = ((int *)obj)[index]; break;
+        case kBufferI64: value.long_long = ((long long *)obj)[index]; break;
+        case kBufferF32: value.doub = ((float *)obj)[index]; break;
+        case kBufferF64: value.doub = ((double *)obj)[index]; break;
+    }
+    return value;
+}
+
+bool MemoryManager::SetBufferItem(Buffer buf, MemSizeT index, Register value) {
+    MemSizeT len, elem_size;
+    auto obj = AccessBufferObj(buf, len, elem_size);
+    if (!obj || index >= len) return !(mem_error_ = true);
+    switch (buf.type) {
+        case kBufferU8: ((unsigned char *)obj)[index] = (unsigned char)value.long_long; break;
+        case kBufferI32: ((int *)obj)[index] = (int)value.long_long; break;
+        case kBufferI64: ((long long *)obj)[index] = value.long_long; break;
+        case kBufferF32: ((float *)obj)[index] = (float)value.doub; break;
+        case kBufferF64: ((double *)obj)[index] = value.doub; break;
+    }
+    return true;
+}
+
+MemSizeT MemoryManager::BufferLength(Buffer buf) {
+    MemSizeT len, elem_size;
+    return AccessBufferObj(buf, len, elem_size) ? len : 0;
+}
+
+char *MemoryManager::AccessBuffer(Buffer buf, MemSizeT &size) {
+    MemSizeT len, elem_size;
+    // depends on the similarity of List and Buffer
+    if (!buf.type) buf.type = kBufferI64;
+    auto obj = AccessBufferObj(buf, len, elem_size);
+    size = obj ? len * elem_size : 0;
+    return obj;
+}
+
+char *MemoryManager::AccessVector(ZValue vec, bool float_list, MemSizeT &length, unsigned int &type) {
+    MemSizeT elem_size;
+    if (vec.buf.type) {
+        type = vec.buf.type;
+        return AccessBufferObj(vec.buf, length, elem_size);
+    }
+    // depends on the similarity of List and Buffer
+    type = float_list ? kBufferF64 : kBufferI64;
+    vec.buf.type = type;
+    return AccessBufferObj(vec.buf, length, elem_size);
+}
+
+Map MemoryManager::AddMapObj(unsigned int key_type) {
+    if (key_type > kMapKeyString) {
+        mem_error_ = true;
+        return {0, 0};
+    }
+    auto size = GetMapObjSize(kMapInitCapacity);
+    auto id = gc_.AddObj(size);
+    if (gc_.gc_error()) {
+        mem_error_ = true;
+        return {0, 0};
+    }
+    auto header = (MapHeader *)gc_.AccessObj(id);
+    memset(header, 0, size);
+    header->key_type = key_type;
+    header->capacity = kMapInitCapacity;
+    gc_.SetContainer(id);
     return {0, id};
 }
 
+char *MemoryManager::FindMapItem(Map map, Register key, bool &found) {
+    auto header = (MapHeader *)gc_.AccessObj(map.position);
+    MapKey map_key;
+    if (!header || !MakeMapKey(*this, header->key_type, key, map_key)) {
+        mem_error_ = true;
+        return nullptr;
+    }
+    return (char *)FindMapSlot(header, map_key, gc_, found);
+}
+
+bool MemoryManager::RebuildMap(Map map, MemSizeT capacity) {
+    auto size = GetMapObjSize(capacity);
+    auto new_id = gc_.AddObj(size);
+    if (gc_.gc_error()) return !(mem_error_ = true);
+    auto header = (MapHeader *)gc_.AccessObj(map.position);
+    auto new_header = (MapHeader *)gc_.AccessObj(new_id);
+    if (!header) return !(mem_error_ = true);
+    memset(new_header, 0, size);
+    new_header->key_type = header->key_type;
+    new_header->count = new_header->used = header->count;
+    new_header->capacity = capacity;
+    // rehash without comparing keys, because keys are unique
+    auto slots = GetMapSlots(header), new_slots = GetMapSlots(new_header);
+    auto mask = capacity - 1;
+    for (MemSizeT i = 0; i < header->capacity; ++i) {
+        if (slots[i].state != kSlotUsed) continue;
+        auto j = slots[i].hash & mask;
+        while (new_slots[j].state != kSlotEmpty) j = (j + 1) & mask;
+        new_slots[j] = slots[i];
+    }
+    if (!gc_.ReplaceObj(map.position, new_id)) return !(mem_error_ = true);
+    return true;
+}
+
+Register MemoryManager::MapGet(Map map, Register key) {
+    bool found;
+    auto slot = (MapSlot *)FindMapItem(map, key, found);
+    if (!slot || !found) return {0};
+    return slot->value;
+}
+
+bool MemoryManager::MapContains(Map map, Register key) {
+    bool found;
+    auto slot = FindMapItem(map, key, found);
+    return slot && found;
+}
+
+bool MemoryManager::MapSet(Map map, Register key, Register value) {
+    bool found;
+    auto slot = (MapSlot *)FindMapItem(map, key, found);
+    if (!slot) return false;
+    if (found) {
+        // values are untyped, a sub-object that was added for
+        // the old value by program is not removed here
+        slot->value = value;
+        return true;
+    }
+
+    // insert a new item, string key will be copied
+    // so that it can not be modified by program
+    auto header = (MapHeader *)gc_.AccessObj(map.position);
+    MapKey map_key;
+    MakeMapKey(*this, header->key_type, key, map_key);
+    std::string key_str;
+    if (map_key.str) {
+        key_str.assign(map_key.str, map_key.len);
+        map_key.str = key_str.c_str();
+    }
+    auto grow = slot->state == kSlotEmpty && IsMapFull(header);
+    auto capacity = kMapInitCapacity;
+    while (capacity < (header->count + 1) * 2) capacity *= 2;
+    // full GC may be triggered only once, before the allocations
+    MemSizeT need_size = map_key.str ? map_key.len + 1 : 0;
+    if (grow) need_size += GetMapObjSize(capacity);
+    if (!gc_.Reserve(need_size)) return !(mem_error_ = true);
+    if (grow && !RebuildMap(map, capacity)) return false;
+    if (map_key.str) {
+        auto id = gc_.AddObjFromMemory(key_str.c_str(), map_key.len + 1);
+        if (gc_.gc_error()) return !(mem_error_ = true);
+        gc_.SetObjHash(id, map_key.hash);
+        gc_.AddElem(map.position, id);
+        if (gc_.gc_error()) return !(mem_error_ = true);
+        ZValue new_key = {{0}};
+        new_key.str = {0, id};
+        map_key.key = new_key.num;
+    }
+
+    header = (MapHeader *)gc_.AccessObj(map.position);
+    if (!header) return !(mem_error_ = true);
+    slot = FindMapSlot(header, map_key, gc_, found);
+    if (slot->state == kSlotEmpty) ++header->used;
+    ++header->count;
+    *slot = {kSlotUsed, map_key.hash, map_key.key, value};
+    return true;
+}
+
+bool MemoryManager::MapDelete(Map map, Register key) {
+    bool found;
+    auto slot = (MapSlot *)FindMapItem(map, key, found);
+    if (!slot) return false;
+    if (!found) return true;
+    auto header = (MapHeader *)gc_.AccessObj(map.position);
+    if (header->key_type == kMapKeyString) {
+        // the copy of key will be collected by GC
+        ZValue str_key = {slot->key};
+        gc_.DelElem(map.position, str_key.str.position);
+    }
+    // like 'MapSet', a sub-object added for the value is kept
+    slot->state = kSlotDeleted;
+    --header->count;
+    return true;
+}
+
+MemSizeT MemoryManager::MapLength(Map map) {
+    auto header = (MapHeader *)gc_.AccessObj(map.position);
+    if (!header) {
+        mem_error_ = true;
+        return 0;
+    }
+    return header->count;
+}
+
+MemSizeT MemoryManager::MapNext(Map map, MemSizeT cursor, Register &key) {
+    auto header = (MapHeader *)gc_.AccessObj(map.position);
+    if (!header) {
+        mem_error_ = true;
+        return 0;
+    }
+    auto slots = GetMapSlots(header);
+    for (auto i = cursor; i < header->capacity; ++i) {
+        if (slots[i].state == kSlotUsed) {
+            key = slots[i].key;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
 bool MemoryManager::ListCompare(List list1, List list2) {
     auto len1 = ListLength(list1);
     if (mem_error_ || len1 != ListLength(list2)) return false;
@@ -193,18 +782,80 @@ List MemoryManager::ListCopy(List list) {
         List list = {0, 0};
         return list;
     };
-    auto obj = gc_.AccessObj(list.position);
+    MemSizeT len;
+    auto obj = gc_.AccessObj(list.position, len);
     if (!obj) return ReturnError();
-    auto len = ListLength(list);
-    if (mem_error_) return ReturnError();
-    auto id = gc_.AddObj(len * sizeof(Register));
+    auto id = gc_.AddObjFromMemory(obj, len);
     if (gc_.gc_error()) return ReturnError();
-    auto new_obj = gc_.AccessObj(id);
-    for (MemSizeT i = 0; i < len * sizeof(Register); ++i) {
-        new_obj[i] = obj[i];
-    }
+    gc_.SetContainer(id);
     return {0, id};
 }
 
+bool MemoryManager::ListSort(List list, unsigned int mode) {
+    MemSizeT len;
+    auto obj = (Register *)gc_.AccessObj(list.position, len);
+    if (!obj) return !(mem_error_ = true);
+    len /= sizeof(Register);
+    auto cmp_mode = mode & ~kSortStable;
+    if (cmp_mode != kSortString) {
+        if (cmp_mode > kSortFloat) return !(mem_error_ = true);
+        // radix sort is always stable
+        vecfunc::Sort(obj, len, cmp_mode == kSortFloat);
+        return true;
+    }
+    // sort String handles by their contents
+    std::vector<StringItem> items(len);
+    for (MemSizeT i = 0; i < len; ++i) {
+        ZValue str = {obj[i]};
+        items[i].str = GetRawString(str.str, items[i].len);
+        if (!items[i].str) return false;
+        items[i].value = obj[i];
+    }
+    if (mode & kSortStable) {
+        std::stable_sort(items.begin(), items.end(), StringItemLess);
+    }
+    else {
+        std::sort(items.begin(), items.end(), StringItemLess);
+    }
+    for (MemSizeT i = 0; i < len; ++i) obj[i] = items[i].value;
+    return true;
+}
+
+long long MemoryManager::ListSearch(List list, Register value, unsigned int mode) {
+    MemSizeT len;
+    auto obj = (Register *)gc_.AccessObj(list.position, len);
+    auto cmp_mode = mode & ~kSortStable;
+    if (!obj || cmp_mode > kSortString) {
+        mem_error_ = true;
+        return 0;
+    }
+    len /= sizeof(Register);
+    if (cmp_mode != kSortString) {
+        return vecfunc::BinarySearch(obj, len, value, cmp_mode == kSortFloat);
+    }
+    ZValue str = {value};
+    StringItem key = {nullptr, 0, value};
+    key.str = GetRawString(str.str, key.len);
+    if (!key.str) return 0;
+    MemSizeT first = 0, last = len;
+    while (first < last) {
+        auto mid = first + (last - first) / 2;
+        str.num = obj[mid];
+        StringItem cur = {nullptr, 0, obj[mid]};
+        cur.str = GetRawString(str.str, cur.len);
+        if (!cur.str) return 0;
+        if (StringItemLess(cur, key)) {
+            first = mid + 1;
+        }
+        else if (StringItemLess(key, cur)) {
+            last = mid;
+        }
+        else {
+            return mid;
+        }
+    }
+    return -(long long)first - 1;
+}
+
 } // namespace zvm
 
@@ -3,74 +3,86 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "type.h"
 #include "gc.h"
+#include "vmem.h"
 
 namespace zvm {
 
 class MemoryManager {
 public:
     MemoryManager(MemSizeT memory_size, MemSizeT stack_size,
-                  MemSizeT gc_pool_size)
+                  PoolSizeT gc_pool_size)
             : mem_size_(memory_size), stack_size_(stack_size),
               gc_(gc_pool_size) { ResetMemory(); }
-    MemoryManager(MemSizeT gc_pool_size) : gc_(gc_pool_size) {}
+    MemoryManager(PoolSizeT gc_pool_size)
+            : gc_(gc_pool_size), mem_error_(false), mem_size_(0), stack_size_(0) {}
     ~MemoryManager() {}
 
     void ResetMemory();
-
-    bool Push(Register value) {
-        if (stack_ptr_ >= stack_size_ - sizeof(Register)) return !(mem_error_ = true);
+    // restore memory to 'image' followed by zero, and clear stack and GC,
+    // only the pages that have been touched will be written
+    void RestoreMemory(const char *image, MemSizeT image_size);
+
+    // memory and stack are surrounded by guard regions, so there is
+    // no bounds checking, out-of-range accesses will trap and be
+    // turned into errors by 'vmem::FaultScope'
+    void Push(Register value) {
         *(Register *)(stack_.get() + stack_ptr_) = value;
         stack_ptr_ += sizeof(Register);
-        return true;
     }
 
     Register Pop() {
-        if (stack_ptr_ < sizeof(Register)) {
-            mem_error_ = true;
-            return {0};
-        }
         stack_ptr_ -= sizeof(Register);
-        return *(Register *)(stack_.get() + stack_ptr_);
+        return *(Register *)(stack_.get() + StackIndex(stack_ptr_));
     }
 
     Register Peek(MemSizeT offset) {
-        if (stack_ptr_ - offset < sizeof(Register)) {
-            mem_error_ = true;
-            return {0};
-        }
-        return *(Register *)(stack_.get() + stack_ptr_ - offset);
+        return *(Register *)(stack_.get() + StackIndex(stack_ptr_ - offset));
+    }
+
+    // exchange the stack with another one, for switching between fibers
+    void SwapStack(vmem::GuardedBlock &stack, MemSizeT &stack_ptr) {
+        std::swap(stack_, stack);
+        std::swap(stack_ptr_, stack_ptr);
     }
 
     char &operator[](MemSizeT index) {   // exposes mem_ to the outside
-        if (index >= mem_size_) {
-            mem_error_ = true;
-            return undefined_[0];
-        }
         return mem_[index];
     }
 
     Register &operator()(MemSizeT index) {
-        if (index + sizeof(Register) >= mem_size_) {
-            mem_error_ = true;
-            return *(Register *)undefined_;
-        }
         return *(Register *)(mem_.get() + index);
     }
 
     String AddStringObj(MemSizeT position);
     String AddStringObj(const std::string &str);
+    // 'data' must not be in GC pool
+    String AddStringObj(const char *data, MemSizeT length);
+    // new string whose content must be filled through 'data'
+    // before the next allocation
+    String AllocStringObj(MemSizeT length, char *&data);
+    // map a file as an immutable string without copying it,
+    // return false if the file can not be mapped
+    bool MapFileString(const char *path, String &str);
     List AddListObj(MemSizeT position, MemSizeT length);
     List AddListObj(const ZValue *data, MemSizeT length);
+    Buffer AddBufferObj(unsigned int type, MemSizeT length);
     bool DelStringObj(String str);
     bool DelListObj(List list);
 
     const char *GetRawString(String str);
+    const char *GetRawString(String str, MemSizeT &length);
     bool SetRawString(String &str, const char *data);
+    bool SetRawString(String &str, const char *data, MemSizeT length);
+    // cut string to 'length' in place
+    bool TruncateString(String str, MemSizeT length);
     bool GetStringObj(String str, MemSizeT position);
     bool SetStringObj(String &str, MemSizeT position);
+    // if the handle refers to a List or a Map instead of a String
+    bool IsContainer(String str) { return gc_.IsContainer(str.position); }
     Register GetListItem(List list, MemSizeT index);
     bool SetListItem(List list, MemSizeT index, Register value);
     void SetRootEnv(List env) { gc_.SetRootObj(env.position); }
@@ -78,30 +90,81 @@ public:
     void DelListRef(List list, List ref);
 
     bool StringCompare(String str1, String str2);
-    bool StringCatenate(String str1, String str2);
+    bool StringCatenate(String &str1, String str2);
     MemSizeT StringLength(String str);
+    // hash of string will be cached until it is modified
+    unsigned int StringHash(String str);
     String StringCopy(String str);
+    long long StringFind(String str, String sub);
+    long long StringFind(String str, char c);
+    List StringSplit(String str, String delim);
+    List StringSplit(String str, char delim);
+
+    Register GetBufferItem(Buffer buf, MemSizeT index);
+    bool SetBufferItem(Buffer buf, MemSizeT index, Register value);
+    MemSizeT BufferLength(Buffer buf);
+    // get the raw data of Buffer or List for block I/O, 'size' is in bytes
+    char *AccessBuffer(Buffer buf, MemSizeT &size);
+    // get the raw data of a Buffer or a List for vector operations
+    // elements of List are treated as 64-bit integers or doubles
+    char *AccessVector(ZValue vec, bool float_list, MemSizeT &length, unsigned int &type);
+
+    Map AddMapObj(unsigned int key_type);
+    Register MapGet(Map map, Register key);
+    bool MapContains(Map map, Register key);
+    bool MapSet(Map map, Register key, Register value);
+    bool MapDelete(Map map, Register key);
+    MemSizeT MapLength(Map map);
+    // return the cursor of next item, 0 if there are no more items
+    MemSizeT MapNext(Map map, MemSizeT cursor, Register &key);
 
     bool ListCompare(List list1, List list2);
     bool ListCatenate(List list1, List list2);
     MemSizeT ListLength(List list);
     List ListCopy(List list);
+    bool ListSort(List list, unsigned int mode);
+    long long ListSearch(List list, Register value, unsigned int mode);
+
+    // save or load memory, stack and GC in snapshot image
+    bool SaveState(snapshot::ImageWriter &writer, snapshot::ImageHeader &header);
+    bool LoadState(const snapshot::ImageReader &reader);
 
     bool mem_error() const { return mem_error_; }
+    void set_mem_error() { mem_error_ = true; }
     MemSizeT memory_size() const { return mem_size_; }
     MemSizeT stack_size() const { return stack_size_; }
+    const vmem::GuardedBlock &memory_block() const { return mem_; }
+    const vmem::GuardedBlock &stack_block() const { return stack_; }
+    MemSizeT const_pool_size() const { return const_pool_size_; }
 
     void set_memory_size(MemSizeT memory_size) { mem_size_ = memory_size; }
     void set_stack_size(MemSizeT stack_size) { stack_size_ = stack_size; }
+    // strings created from constant pool will be interned if they are
+    // still the same as 'pool', which is the image of constant pool
+    void set_const_pool(const char *pool, MemSizeT size) {
+        const_pool_ = pool;
+        const_pool_size_ = size;
+    }
 
 private:
+    // stacks of fibers only have a guard page after them, so an index
+    // that wraps around is moved to the end of stack, where it still traps
+    MemSizeT StackIndex(MemSizeT index) const {
+        return index < stack_.size() ? index : stack_.size();
+    }
+
+    List SplitString(String str, const char *delim, MemSizeT delim_len);
+    char *AccessBufferObj(Buffer buf, MemSizeT &length, MemSizeT &elem_size);
+    char *FindMapItem(Map map, Register key, bool &found);
+    bool RebuildMap(Map map, MemSizeT capacity);
+
     GarbageCollector gc_;
 
     bool mem_error_;
-    char undefined_[sizeof(Register)];
-    std::unique_ptr<char[]> mem_, stack_;
+    vmem::GuardedBlock mem_, stack_;
     MemSizeT stack_ptr_;
-    MemSizeT mem_size_, stack_size_;
+    MemSizeT mem_size_, stack_size_, const_pool_size_ = 0;
+    const char *const_pool_ = nullptr;
 };
 
 } // namespace zvm
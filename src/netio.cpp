@@ -0,0 +1,150 @@
+#include "netio.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+namespace {
+
+const char kUnixPrefix[] = "unix:";
+const std::size_t kUnixPrefixLength = sizeof(kUnixPrefix) - 1;
+const int kMaxEvents = 1024;
+
+union SocketAddress {
+    sockaddr addr;
+    sockaddr_un unix_addr;
+    sockaddr_in inet_addr;
+};
+
+// parse address, return the length of address, or 0 if failed
+socklen_t ParseAddress(const char *address, SocketAddress &sa) {
+    memset(&sa, 0, sizeof(sa));
+    if (!strncmp(address, kUnixPrefix, kUnixPrefixLength)) {
+        auto path = address + kUnixPrefixLength;
+        auto len = strlen(path);
+        if (!len || len >= sizeof(sa.unix_addr.sun_path)) return 0;
+        sa.unix_addr.sun_family = AF_UNIX;
+        memcpy(sa.unix_addr.sun_path, path, len);
+        return sizeof(sa.unix_addr);
+    }
+    auto colon = strrchr(address, ':');
+    if (!colon || colon == address) return 0;
+    char host[INET_ADDRSTRLEN];
+    std::size_t host_len = colon - address;
+    if (host_len >= sizeof(host)) return 0;
+    memcpy(host, address, host_len);
+    host[host_len] = '\0';
+    char *end;
+    auto port = strtol(colon + 1, &end, 10);
+    if (*end || end == colon + 1 || port < 0 || port > 0xFFFF) return 0;
+    sa.inet_addr.sin_family = AF_INET;
+    sa.inet_addr.sin_port = htons((unsigned short)port);
+    if (!strcmp(host, "localhost")) {
+        sa.inet_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+    else if (inet_pton(AF_INET, host, &sa.inet_addr.sin_addr) != 1) {
+        return 0;
+    }
+    return sizeof(sa.inet_addr);
+}
+
+// requests are usually small, so do not wait for more data to send
+void SetNoDelay(int fd) {
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+} // namespace
+
+namespace zvm {
+
+namespace net {
+
+int Listen(const char *address, int backlog) {
+    SocketAddress sa;
+    auto len = ParseAddress(address, sa);
+    if (!len) return -1;
+    auto fd = socket(sa.addr.sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (sa.addr.sa_family == AF_UNIX) {
+        // remove the socket file left by the last run
+        unlink(sa.unix_addr.sun_path);
+    }
+    else {
+        int flag = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+    }
+    if (bind(fd, &sa.addr, len) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int Connect(const char *address) {
+    SocketAddress sa;
+    auto len = ParseAddress(address, sa);
+    if (!len) return -1;
+    auto fd = socket(sa.addr.sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    // connect in blocking mode, local connections will not take long
+    int ret;
+    while ((ret = connect(fd, &sa.addr, len)) < 0 && errno == EINTR);
+    if (ret < 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (sa.addr.sa_family == AF_INET) SetNoDelay(fd);
+    return fd;
+}
+
+int Accept(int fd) {
+    SocketAddress sa;
+    socklen_t len = sizeof(sa);
+    int conn;
+    while ((conn = accept4(fd, &sa.addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0
+            && errno == EINTR);
+    if (conn >= 0 && sa.addr.sa_family == AF_INET) SetNoDelay(conn);
+    return conn;
+}
+
+bool Poller::Watch(int fd, int events) {
+    if (fd_ < 0 && (fd_ = epoll_create1(EPOLL_CLOEXEC)) < 0) return false;
+    if (!events) return !epoll_ctl(fd_, EPOLL_CTL_DEL, fd, nullptr) || errno == ENOENT;
+    epoll_event ev;
+    ev.events = (events & kPollRead ? EPOLLIN : 0) | (events & kPollWrite ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    if (!epoll_ctl(fd_, EPOLL_CTL_MOD, fd, &ev)) return true;
+    return errno == ENOENT && !epoll_ctl(fd_, EPOLL_CTL_ADD, fd, &ev);
+}
+
+bool Poller::Wait(int timeout, std::vector<int> &ready) {
+    ready.clear();
+    if (fd_ < 0 && (fd_ = epoll_create1(EPOLL_CLOEXEC)) < 0) return false;
+    epoll_event events[kMaxEvents];
+    int count;
+    while ((count = epoll_wait(fd_, events, kMaxEvents, timeout)) < 0 && errno == EINTR);
+    if (count < 0) return false;
+    for (int i = 0; i < count; ++i) ready.push_back(events[i].data.fd);
+    return true;
+}
+
+void Poller::Close() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+} // namespace net
+
+} // namespace zvm
@@ -0,0 +1,48 @@
+#ifndef ZVM_NETIO_H_
+#define ZVM_NETIO_H_
+
+#include <vector>
+#include <cstddef>
+
+namespace zvm {
+
+namespace net {
+
+// address: "unix:<path>" for Unix domain sockets,
+// or "<IPv4 address>:<port>" ("localhost" is accepted) for TCP
+// all of the sockets are non-blocking, return -1 if failed
+int Listen(const char *address, int backlog);
+int Connect(const char *address);
+// return -1 if there is no pending connection
+int Accept(int fd);
+
+// events that can be watched by 'Poller'
+enum PollEvent {
+    kPollRead = 1,
+    kPollWrite = 2
+};
+
+// level-triggered readiness notification of file descriptors (epoll)
+class Poller {
+public:
+    Poller() : fd_(-1) {}
+    Poller(const Poller &) = delete;
+    Poller &operator=(const Poller &) = delete;
+    ~Poller() { Close(); }
+
+    // set the watched events of 'fd', zero means stop watching
+    bool Watch(int fd, int events);
+    // wait until some of file descriptors are ready or timeout
+    // (in milliseconds, -1 means forever), return false if failed
+    bool Wait(int timeout, std::vector<int> &ready);
+    void Close();
+
+private:
+    int fd_;
+};
+
+} // namespace net
+
+} // namespace zvm
+
+#endif // ZVM_NETIO_H_
@@ -0,0 +1,83 @@
+#include "program.h"
+
+#include <cstring>
+
+#include "snapshot.h"
+
+namespace zvm {
+
+std::shared_ptr<const Program> Program::Load(const char *path) {
+    std::shared_ptr<Program> program(new Program());
+    if (!program->LoadFile(path)) return nullptr;
+    return program;
+}
+
+std::shared_ptr<const Program> Program::LoadImage(const char *path) {
+    std::shared_ptr<Program> program(new Program());
+    if (!program->LoadImageFile(path)) return nullptr;
+    return program;
+}
+
+bool Program::LoadImageFile(const char *path) {
+    if (!file_.Open(path)) return false;
+    auto data = file_.data();
+    auto len = file_.size();
+    if (len < sizeof(snapshot::ImageHeader)) return false;
+    snapshot::ImageHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    // padding of code is saved in image
+    auto code_size = (std::uint64_t)header.code_size + kCodePadding;
+    if (header.code_offset > len || code_size > len - header.code_offset) return false;
+    if (header.const_pool_offset > len
+            || header.const_pool_size > len - header.const_pool_offset) {
+        return false;
+    }
+    if (header.const_pool_size >= header.mem_size) return false;
+    mem_size_ = header.mem_size;
+    stack_size_ = header.stack_size;
+    const_pool_ = data + header.const_pool_offset;
+    const_pool_size_ = header.const_pool_size;
+    code_ = data + header.code_offset;
+    code_size_ = header.code_size;
+    return true;
+}
+
+bool Program::LoadFile(const char *path) {
+    if (!file_.Open(path)) return false;
+    auto data = file_.data();
+    auto len = file_.size();
+    if (len < kBytecodeHeaderLength) return false;
+
+    auto header = data, version = data + 3;
+    if (header[0] != '\x93' || header[1] != '\x94' || header[2] != '\x86') return false;
+    if (version[0] > kCurrentVersion[0] || version[0] < kMinimumVersion[0]) {
+        return false;
+    }
+    else if(version[1] > kCurrentVersion[1] || version[0] < kMinimumVersion[0]) {
+        return false;
+    }
+
+    MemSizeT size_info[4];   // memory, stack, constant pool, code
+    memcpy(size_info, data + 5, sizeof(size_info));
+    mem_size_ = size_info[0];
+    stack_size_ = size_info[1];
+    auto const_pool_pos = size_info[2], code_pos = size_info[3];
+    if (const_pool_pos > code_pos || code_pos > len) return false;
+    const_pool_size_ = code_pos - const_pool_pos;
+    if (const_pool_size_ >= mem_size_) return false;
+    const_pool_ = data + const_pool_pos;
+
+    code_size_ = len - code_pos;
+    if (file_.slack() >= kCodePadding) {
+        code_ = data + code_pos;
+    }
+    else {
+        code_buffer_ = std::make_unique<char[]>(code_size_ + kCodePadding);
+        memcpy(code_buffer_.get(), data + code_pos, code_size_);
+        code_ = code_buffer_.get();
+    }
+    return true;
+}
+
+} // namespace zvm
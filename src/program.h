@@ -0,0 +1,51 @@
+#ifndef ZVM_PROGRAM_H_
+#define ZVM_PROGRAM_H_
+
+#include <memory>
+
+#include "type.h"
+#include "vmem.h"
+
+namespace zvm {
+
+// immutable image of a bytecode file, which can be shared by
+// many VM instances without loading the file again
+// code is executed in place and not decoded when loading, so there is
+// nothing to cache between runs except the mapping of file itself
+class Program {
+public:
+    Program(const Program &) = delete;
+    Program &operator=(const Program &) = delete;
+    ~Program() {}
+
+    // return nullptr if file is not a valid bytecode file
+    static std::shared_ptr<const Program> Load(const char *path);
+    // load code and constant pool from snapshot image
+    static std::shared_ptr<const Program> LoadImage(const char *path);
+
+    MemSizeT memory_size() const { return mem_size_; }
+    MemSizeT stack_size() const { return stack_size_; }
+    const char *const_pool() const { return const_pool_; }
+    MemSizeT const_pool_size() const { return const_pool_size_; }
+    // there are at least 'kCodePadding' zero bytes after the code
+    const char *code() const { return code_; }
+    MemSizeT code_size() const { return code_size_; }
+
+private:
+    Program() : const_pool_(nullptr), code_(nullptr) {}
+
+    bool LoadFile(const char *path);
+    bool LoadImageFile(const char *path);
+
+    // code is used from the mapping of bytecode file directly
+    // or from 'code_buffer_' if there is no enough padding after it
+    vmem::MappedFile file_;
+    std::unique_ptr<char[]> code_buffer_;
+    MemSizeT mem_size_, stack_size_;
+    const char *const_pool_, *code_;
+    MemSizeT const_pool_size_, code_size_;
+};
+
+} // namespace zvm
+
+#endif // ZVM_PROGRAM_H_
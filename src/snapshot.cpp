@@ -0,0 +1,97 @@
+#include "snapshot.h"
+
+#include <cstring>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace zvm {
+
+namespace snapshot {
+
+bool ImageWriter::Open(const char *path) {
+    Close();
+    fd_ = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    // the first page is reserved for header
+    offset_ = vmem::AlignToPage(sizeof(ImageHeader));
+    error_ = fd_ < 0;
+    return !error_;
+}
+
+void ImageWriter::Close() {
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+}
+
+std::uint64_t ImageWriter::WriteSection(const void *data, std::size_t size) {
+    offset_ = vmem::AlignToPage(offset_);
+    auto section = offset_;
+    Append(data, size);
+    return section;
+}
+
+void ImageWriter::Append(const void *data, std::size_t size) {
+    auto pos = (const char *)data;
+    while (size && !error_) {
+        auto ret = pwrite(fd_, pos, size, offset_);
+        if (ret <= 0) {
+            error_ = true;
+            break;
+        }
+        pos += ret;
+        size -= ret;
+        offset_ += ret;
+    }
+}
+
+bool ImageWriter::Finish(ImageHeader &header) {
+    memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+    header.version = kImageVersion;
+    header.page_size = vmem::PageSize();
+    // make sure that the last section can be mapped completely
+    if (!error_ && ftruncate(fd_, vmem::AlignToPage(offset_))) error_ = true;
+    if (!error_ && pwrite(fd_, &header, sizeof(header), 0) != sizeof(header)) {
+        error_ = true;
+    }
+    Close();
+    return !error_;
+}
+
+bool ImageReader::Open(const char *path) {
+    Close();
+    fd_ = open(path, O_RDONLY);
+    if (fd_ < 0 || !file_.Open(path) || file_.size() < sizeof(ImageHeader)) {
+        Close();
+        return false;
+    }
+    const auto &h = header();
+    if (memcmp(h.magic, kImageMagic, sizeof(kImageMagic)) || h.version != kImageVersion
+            || h.page_size != vmem::PageSize()) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void ImageReader::Close() {
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+    file_.Close();
+}
+
+bool ImageReader::Contains(std::uint64_t offset, std::uint64_t size) const {
+    return offset <= file_.size() && size <= file_.size() - offset;
+}
+
+bool ImageReader::MapSection(void *address, std::uint64_t offset, std::size_t size) const {
+    size = vmem::AlignToPage(size);
+    if (!size) return true;
+    if (offset % vmem::PageSize() || !Contains(offset, size)) return false;
+    auto ret = mmap(address, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd_, offset);
+    return ret == address;
+}
+
+} // namespace snapshot
+
+} // namespace zvm
@@ -0,0 +1,101 @@
+#ifndef ZVM_SNAPSHOT_H_
+#define ZVM_SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "type.h"
+#include "vmem.h"
+
+namespace zvm {
+
+namespace snapshot {
+
+const char kImageMagic[4] = {'Z', 'I', 'M', 'G'};
+const unsigned int kImageVersion = 3;
+
+// layout of image file: header, sections
+// every section begins at a page boundary, so memory, stack and GC pool
+// can be mapped (copy-on-write) from file directly
+struct ImageHeader {
+    char magic[4];
+    unsigned int version, page_size;
+    // program
+    MemSizeT mem_size, stack_size, const_pool_size, code_size;
+    std::uint64_t code_offset, const_pool_offset;
+    // memory manager
+    MemSizeT stack_ptr;
+    std::uint64_t mem_offset, stack_offset;
+    // garbage collector
+    std::uint64_t gc_pool_size, gc_stack_ptr;
+    unsigned int obj_id, root_id;
+    std::uint64_t gc_pool_offset;
+    std::uint64_t obj_count, obj_table_offset, obj_table_size;
+    std::uint64_t free_id_count, free_id_offset;
+    // registers
+    Register reg[kRegisterCount];
+};
+
+// record of a GC object in object table, followed by its sub-objects
+struct ObjRecord {
+    unsigned int id;
+    std::uint64_t position;
+    MemSizeT length;
+    unsigned int interned, hashed, hash, container;
+    MemSizeT elem_count;
+};
+
+class ImageWriter {
+public:
+    ImageWriter() : fd_(-1), error_(false), offset_(0) {}
+    ImageWriter(const ImageWriter &) = delete;
+    ImageWriter &operator=(const ImageWriter &) = delete;
+    ~ImageWriter() { Close(); }
+
+    bool Open(const char *path);
+    void Close();
+
+    // append a section, return its offset
+    std::uint64_t WriteSection(const void *data, std::size_t size);
+    // append data to the last section
+    void Append(const void *data, std::size_t size);
+    // write header to the beginning of file, and close file
+    bool Finish(ImageHeader &header);
+
+    bool error() const { return error_; }
+
+private:
+    int fd_;
+    bool error_;
+    std::uint64_t offset_;
+};
+
+class ImageReader {
+public:
+    ImageReader() : fd_(-1) {}
+    ImageReader(const ImageReader &) = delete;
+    ImageReader &operator=(const ImageReader &) = delete;
+    ~ImageReader() { Close(); }
+
+    // open file and check the header
+    bool Open(const char *path);
+    void Close();
+
+    const ImageHeader &header() const { return *(const ImageHeader *)file_.data(); }
+    // content of section that is read-only
+    const char *section(std::uint64_t offset) const { return file_.data() + offset; }
+    // check if section is in the file
+    bool Contains(std::uint64_t offset, std::uint64_t size) const;
+    // map section to 'address' (must be aligned to page), copy-on-write
+    bool MapSection(void *address, std::uint64_t offset, std::size_t size) const;
+
+private:
+    int fd_;
+    vmem::MappedFile file_;
+};
+
+} // namespace snapshot
+
+} // namespace zvm
+
+#endif // ZVM_SNAPSHOT_H_
@@ -0,0 +1,158 @@
+#include "strfunc.h"
+
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+#include <string>
+#include <charconv>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ZVM_STRFUNC_X86
+#endif
+
+namespace {
+
+using zvm::MemSizeT;
+using FindFunc = long long (*)(const char *, MemSizeT, const char *, MemSizeT);
+
+long long FindScalar(const char *str, MemSizeT len, const char *sub, MemSizeT sub_len) {
+    MemSizeT i = 0;
+    while (i + sub_len <= len) {
+        auto pos = (const char *)memchr(str + i, sub[0], len - sub_len + 1 - i);
+        if (!pos) return -1;
+        i = pos - str;
+        if (!memcmp(pos + 1, sub + 1, sub_len - 1)) return i;
+        ++i;
+    }
+    return -1;
+}
+
+#ifdef ZVM_STRFUNC_X86
+
+// compare the first and the last character of 'sub' with a block of 'str'
+// at the same time, and only call 'memcmp' on candidate positions
+// see: http://0x80.pl/articles/simd-strfind.html
+__attribute__((target("sse2")))
+long long FindSSE2(const char *str, MemSizeT len, const char *sub, MemSizeT sub_len) {
+    const auto first = _mm_set1_epi8(sub[0]);
+    const auto last = _mm_set1_epi8(sub[sub_len - 1]);
+    MemSizeT i = 0;
+    for (; i + sub_len + 15 <= len; i += 16) {
+        auto block_first = _mm_loadu_si128((const __m128i *)(str + i));
+        auto block_last = _mm_loadu_si128((const __m128i *)(str + i + sub_len - 1));
+        auto eq = _mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                _mm_cmpeq_epi8(last, block_last));
+        auto mask = (unsigned int)_mm_movemask_epi8(eq);
+        while (mask) {
+            auto bit = __builtin_ctz(mask);
+            if (!memcmp(str + i + bit + 1, sub + 1, sub_len - 2)) return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    auto ret = FindScalar(str + i, len - i, sub, sub_len);
+    return ret < 0 ? ret : ret + i;
+}
+
+__attribute__((target("avx2")))
+long long FindAVX2(const char *str, MemSizeT len, const char *sub, MemSizeT sub_len) {
+    const auto first = _mm256_set1_epi8(sub[0]);
+    const auto last = _mm256_set1_epi8(sub[sub_len - 1]);
+    MemSizeT i = 0;
+    for (; i + sub_len + 31 <= len; i += 32) {
+        auto block_first = _mm256_loadu_si256((const __m256i *)(str + i));
+        auto block_last = _mm256_loadu_si256((const __m256i *)(str + i + sub_len - 1));
+        auto eq = _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                   _mm256_cmpeq_epi8(last, block_last));
+        auto mask = (unsigned int)_mm256_movemask_epi8(eq);
+        while (mask) {
+            auto bit = __builtin_ctz(mask);
+            if (!memcmp(str + i + bit + 1, sub + 1, sub_len - 2)) return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    auto ret = FindScalar(str + i, len - i, sub, sub_len);
+    return ret < 0 ? ret : ret + i;
+}
+
+#endif // ZVM_STRFUNC_X86
+
+FindFunc SelectFind() {
+#ifdef ZVM_STRFUNC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return FindAVX2;
+    if (__builtin_cpu_supports("sse2")) return FindSSE2;
+#endif
+    return FindScalar;
+}
+
+const FindFunc find_impl = SelectFind();
+
+// skip leading spaces and '+', return the new start position
+const char *SkipPrefix(const char *str, const char *end) {
+    while (str < end && isspace(*str)) ++str;
+    if (str + 1 < end && str[0] == '+' && str[1] != '-') ++str;
+    return str;
+}
+
+} // namespace
+
+namespace zvm {
+
+namespace strfunc {
+
+long long Find(const char *str, MemSizeT len, const char *sub, MemSizeT sub_len) {
+    if (!sub_len) return 0;
+    if (sub_len > len) return -1;
+    if (sub_len == 1) return Find(str, len, sub[0]);
+    return find_impl(str, len, sub, sub_len);
+}
+
+long long Find(const char *str, MemSizeT len, char c) {
+    // 'memchr' of libc has already been vectorized
+    auto pos = (const char *)memchr(str, c, len);
+    return pos ? pos - str : -1;
+}
+
+unsigned int Hash(const char *str, MemSizeT len) {
+    unsigned int hash = 2166136261u;
+    for (MemSizeT i = 0; i < len; ++i) {
+        hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+    }
+    return hash;
+}
+
+MemSizeT FormatInteger(long long value, char *buffer) {
+    auto ret = std::to_chars(buffer, buffer + kNumberBufferSize, value);
+    return ret.ptr - buffer;
+}
+
+MemSizeT FormatFloat(double value, char *buffer) {
+    auto ret = std::to_chars(buffer, buffer + kNumberBufferSize, value);
+    return ret.ptr - buffer;
+}
+
+long long ParseInteger(const char *str, MemSizeT len) {
+    auto end = str + len;
+    long long value = 0;
+    auto ret = std::from_chars(SkipPrefix(str, end), end, value);
+    if (ret.ec == std::errc::result_out_of_range) {
+        // let libc decide how to saturate
+        return strtoll(std::string(str, len).c_str(), nullptr, 10);
+    }
+    return value;
+}
+
+double ParseFloat(const char *str, MemSizeT len) {
+    auto end = str + len;
+    double value = 0;
+    auto ret = std::from_chars(SkipPrefix(str, end), end, value);
+    if (ret.ec == std::errc::result_out_of_range) {
+        return strtod(std::string(str, len).c_str(), nullptr);
+    }
+    return value;
+}
+
+} // namespace strfunc
+
+} // namespace zvm
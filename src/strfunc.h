@@ -0,0 +1,33 @@
+#ifndef ZVM_STRFUNC_H_
+#define ZVM_STRFUNC_H_
+
+#include "type.h"
+
+namespace zvm {
+
+namespace strfunc {
+
+// find the first occurrence of 'sub' in 'str', return -1 if not found
+// SSE2/AVX2 kernel will be selected at runtime if CPU supports it
+long long Find(const char *str, MemSizeT len, const char *sub, MemSizeT sub_len);
+long long Find(const char *str, MemSizeT len, char c);
+
+// 32-bit FNV-1a hash of string
+unsigned int Hash(const char *str, MemSizeT len);
+
+// enough to hold any integer or the shortest form of any double
+const MemSizeT kNumberBufferSize = 32;
+
+// write number to buffer without '\0', return the length
+// floating point numbers are written in the shortest round-trip form
+MemSizeT FormatInteger(long long value, char *buffer);
+MemSizeT FormatFloat(double value, char *buffer);
+// leading spaces and '+' are allowed, same as 'strtoll' and 'strtod'
+long long ParseInteger(const char *str, MemSizeT len);
+double ParseFloat(const char *str, MemSizeT len);
+
+} // namespace strfunc
+
+} // namespace zvm
+
+#endif // ZVM_STRFUNC_H_
@@ -19,6 +19,41 @@ struct List {
     unsigned int position;
 };
 
+// type of elements is stored in the place of 'reserved' field
+// String and List always have a zero 'reserved' field
+struct Buffer {
+    unsigned int type;
+    unsigned int position;
+};
+
+enum BufferType {
+    kBufferU8 = 1,
+    kBufferI32,
+    kBufferI64,
+    kBufferF32,
+    kBufferF64
+};
+
+// type of keys is stored in the object instead of the handle,
+// so that Map can not be mistaken for a Buffer
+struct Map {
+    unsigned int reserved;
+    unsigned int position;
+};
+
+enum MapKeyType {
+    kMapKeyInteger,
+    kMapKeyString
+};
+
+// comparison mode of sorting and searching a List
+enum ListSortMode {
+    kSortInteger,
+    kSortFloat,
+    kSortString,
+    kSortStable = 4   // flag, use stable sorting algorithm
+};
+
 // that means Function structure can be read as a List directly
 struct Function {
     unsigned int position;
@@ -29,12 +64,13 @@ union ZValue {
     Number num;
     String str;
     List list;
+    Buffer buf;
+    Map map;
     Function func;
 };
 
 const unsigned int kMemorySize = 1024 * 32;   // 32k
 const unsigned int kStackSize = 1024 * 16;    // 16k
-const unsigned int kCacheSize = 1024 * 512;   // 512k
 const unsigned int kGCPoolSize = 1024 * 128;  // 128k
 
 const char kRegisterCount = 16;
@@ -42,6 +78,8 @@ const char kArgRegisterCount = 6;
 const char kArgRegisterOffset = 8;
 
 const char kBytecodeHeaderLength = sizeof(unsigned char) * 5 + sizeof(unsigned int) * 4;
+// zero padding after code, longer than any instruction
+const unsigned int kCodePadding = 16;
 const unsigned char kCurrentVersion[2] = {0, 7};
 const unsigned char kMinimumVersion[2] = {0, 7};
 
@@ -50,11 +88,16 @@ enum VMReturnCode {
     kProgramError, 
     kStackError, 
     kMemoryError, 
-    kCacheError
+    kCacheError, 
+    kBreakpoint, 
+    kSuspended
 };
 
 using Register = Number;
 using MemSizeT = unsigned int;   // type that can storage memory size
+// type that can storage the size of GC pool, objects are still referred
+// by 32-bit id, so heap can be larger than 4GB
+using PoolSizeT = unsigned long long;
 
 } // namespace zvm
 
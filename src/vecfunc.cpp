@@ -0,0 +1,262 @@
+#include "vecfunc.h"
+
+#include <type_traits>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+
+namespace {
+
+using zvm::MemSizeT;
+using zvm::Register;
+
+// number of independent accumulators in reductions, so that
+// the compiler can keep them in vector registers (SSE2/AVX2)
+const MemSizeT kLaneCount = 8;
+
+// type of the result of elements with type T
+template <typename T>
+using Acc = std::conditional_t<std::is_floating_point<T>::value, double, long long>;
+
+inline void SetRegister(Register &reg, long long value) { reg.long_long = value; }
+inline void SetRegister(Register &reg, double value) { reg.doub = value; }
+inline void GetRegister(const Register &reg, long long &value) { value = reg.long_long; }
+inline void GetRegister(const Register &reg, double &value) { value = reg.doub; }
+
+// call 'func' with a null pointer whose type is the type of elements
+template <typename Func>
+inline void ForType(unsigned int type, Func func) {
+    switch (type) {
+        case zvm::kBufferU8: func((unsigned char *)nullptr); break;
+        case zvm::kBufferI32: func((int *)nullptr); break;
+        case zvm::kBufferI64: func((long long *)nullptr); break;
+        case zvm::kBufferF32: func((float *)nullptr); break;
+        case zvm::kBufferF64: func((double *)nullptr); break;
+    }
+}
+
+template <typename T>
+Acc<T> SumKernel(const T *data, MemSizeT len) {
+    Acc<T> lane[kLaneCount] = {0};
+    MemSizeT i = 0;
+    for (; i + kLaneCount <= len; i += kLaneCount) {
+        for (MemSizeT j = 0; j < kLaneCount; ++j) lane[j] += data[i + j];
+    }
+    Acc<T> sum = 0;
+    for (MemSizeT j = 0; j < kLaneCount; ++j) sum += lane[j];
+    for (; i < len; ++i) sum += data[i];
+    return sum;
+}
+
+template <typename T>
+Acc<T> DotKernel(const T *data1, const T *data2, MemSizeT len) {
+    Acc<T> lane[kLaneCount] = {0};
+    MemSizeT i = 0;
+    for (; i + kLaneCount <= len; i += kLaneCount) {
+        for (MemSizeT j = 0; j < kLaneCount; ++j) {
+            lane[j] += (Acc<T>)data1[i + j] * data2[i + j];
+        }
+    }
+    Acc<T> sum = 0;
+    for (MemSizeT j = 0; j < kLaneCount; ++j) sum += lane[j];
+    for (; i < len; ++i) sum += (Acc<T>)data1[i] * data2[i];
+    return sum;
+}
+
+template <bool kMin, typename T>
+T MinMaxKernel(const T *data, MemSizeT len) {
+    if (!len) return 0;
+    T lane[kLaneCount];
+    for (MemSizeT j = 0; j < kLaneCount; ++j) lane[j] = data[0];
+    MemSizeT i = 0;
+    for (; i + kLaneCount <= len; i += kLaneCount) {
+        for (MemSizeT j = 0; j < kLaneCount; ++j) {
+            auto cur = data[i + j];
+            lane[j] = (kMin ? cur < lane[j] : cur > lane[j]) ? cur : lane[j];
+        }
+    }
+    auto ret = lane[0];
+    for (MemSizeT j = 1; j < kLaneCount; ++j) {
+        ret = (kMin ? lane[j] < ret : lane[j] > ret) ? lane[j] : ret;
+    }
+    for (; i < len; ++i) {
+        ret = (kMin ? data[i] < ret : data[i] > ret) ? data[i] : ret;
+    }
+    return ret;
+}
+
+// use insertion sort when the length of data is less than this value
+const MemSizeT kRadixSortThreshold = 64;
+
+// convert integer or double to an unsigned key that has the same order
+inline unsigned long long GetSortKey(Register value, bool is_float) {
+    auto bits = (unsigned long long)value.long_long;
+    const auto sign = 1ULL << 63;
+    if (!is_float) return bits ^ sign;
+    return (bits & sign) ? ~bits : bits | sign;
+}
+
+// LSD radix sort, 8 bits per pass
+void RadixSort(Register *data, MemSizeT len, bool is_float) {
+    auto keys = std::make_unique<unsigned long long[]>(len * 2);
+    auto temp = std::make_unique<Register[]>(len);
+    auto src_key = keys.get(), dst_key = keys.get() + len;
+    auto src = data, dst = temp.get();
+    // build histograms of all passes at once
+    MemSizeT count[8][256] = {{0}};
+    for (MemSizeT i = 0; i < len; ++i) {
+        src_key[i] = GetSortKey(data[i], is_float);
+        for (int pass = 0; pass < 8; ++pass) {
+            ++count[pass][(src_key[i] >> (pass * 8)) & 0xFF];
+        }
+    }
+    for (int pass = 0; pass < 8; ++pass) {
+        auto shift = pass * 8;
+        auto &hist = count[pass];
+        // skip the pass if all keys have the same digit
+        if (hist[(src_key[0] >> shift) & 0xFF] == len) continue;
+        MemSizeT offset = 0;
+        for (auto &i : hist) {
+            auto cur = i;
+            i = offset;
+            offset += cur;
+        }
+        for (MemSizeT i = 0; i < len; ++i) {
+            auto pos = hist[(src_key[i] >> shift) & 0xFF]++;
+            dst_key[pos] = src_key[i];
+            dst[pos] = src[i];
+        }
+        std::swap(src_key, dst_key);
+        std::swap(src, dst);
+    }
+    if (src != data) memcpy(data, src, len * sizeof(Register));
+}
+
+} // namespace
+
+namespace zvm {
+
+namespace vecfunc {
+
+Register Sum(const char *data, MemSizeT len, unsigned int type) {
+    Register ret = {0};
+    ForType(type, [&](auto tag) {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        SetRegister(ret, SumKernel((const T *)data, len));
+    });
+    return ret;
+}
+
+Register Min(const char *data, MemSizeT len, unsigned int type) {
+    Register ret = {0};
+    ForType(type, [&](auto tag) {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        SetRegister(ret, (Acc<T>)MinMaxKernel<true>((const T *)data, len));
+    });
+    return ret;
+}
+
+Register Max(const char *data, MemSizeT len, unsigned int type) {
+    Register ret = {0};
+    ForType(type, [&](auto tag) {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        SetRegister(ret, (Acc<T>)MinMaxKernel<false>((const T *)data, len));
+    });
+    return ret;
+}
+
+Register Dot(const char *data1, const char *data2, MemSizeT len, unsigned int type) {
+    Register ret = {0};
+    ForType(type, [&](auto tag) {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        SetRegister(ret, DotKernel((const T *)data1, (const T *)data2, len));
+    });
+    return ret;
+}
+
+void Add(char *dst, const char *src, MemSizeT len, unsigned int type) {
+    ForType(type, [&](auto tag) {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        auto d = (T *)dst;
+        auto s = (const T *)src;
+        for (MemSizeT i = 0; i < len; ++i) d[i] += s[i];
+    });
+}
+
+void Mul(char *dst, const char *src, MemSizeT len, unsigned int type) {
+    ForType(type, [&](auto tag) {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        auto d = (T *)dst;
+        auto s = (const T *)src;
+        for (MemSizeT i = 0; i < len; ++i) d[i] *= s[i];
+    });
+}
+
+void AddScalar(char *data, MemSizeT len, unsigned int type, Register value) {
+    ForType(type, [&](auto tag) {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        Acc<T> acc_val;
+        GetRegister(value, acc_val);
+        auto d = (T *)data;
+        auto v = (T)acc_val;
+        for (MemSizeT i = 0; i < len; ++i) d[i] += v;
+    });
+}
+
+void MulScalar(char *data, MemSizeT len, unsigned int type, Register value) {
+    ForType(type, [&](auto tag) {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        Acc<T> acc_val;
+        GetRegister(value, acc_val);
+        auto d = (T *)data;
+        auto v = (T)acc_val;
+        for (MemSizeT i = 0; i < len; ++i) d[i] *= v;
+    });
+}
+
+void PrefixSum(char *data, MemSizeT len, unsigned int type) {
+    ForType(type, [&](auto tag) {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        auto d = (T *)data;
+        for (MemSizeT i = 1; i < len; ++i) d[i] += d[i - 1];
+    });
+}
+
+void Sort(Register *data, MemSizeT len, bool is_float) {
+    if (len >= kRadixSortThreshold) {
+        RadixSort(data, len, is_float);
+        return;
+    }
+    for (MemSizeT i = 1; i < len; ++i) {
+        auto cur = data[i];
+        auto key = GetSortKey(cur, is_float);
+        auto j = i;
+        for (; j > 0 && GetSortKey(data[j - 1], is_float) > key; --j) {
+            data[j] = data[j - 1];
+        }
+        data[j] = cur;
+    }
+}
+
+long long BinarySearch(const Register *data, MemSizeT len, Register value, bool is_float) {
+    auto key = GetSortKey(value, is_float);
+    MemSizeT first = 0, last = len;
+    while (first < last) {
+        auto mid = first + (last - first) / 2;
+        auto cur = GetSortKey(data[mid], is_float);
+        if (cur < key) {
+            first = mid + 1;
+        }
+        else if (cur > key) {
+            last = mid;
+        }
+        else {
+            return mid;
+        }
+    }
+    return -(long long)first - 1;
+}
+
+} // namespace vecfunc
+
+} // namespace zvm
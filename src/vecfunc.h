@@ -0,0 +1,40 @@
+#ifndef ZVM_VECFUNC_H_
+#define ZVM_VECFUNC_H_
+
+#include "type.h"
+
+namespace zvm {
+
+namespace vecfunc {
+
+// 'type' is the type of elements (BufferType), the results of integer
+// vectors are 64-bit integers, and the results of floating point
+// vectors are double-precision floating point numbers
+// NOTICE: these functions will not check if 'type' is valid
+
+Register Sum(const char *data, MemSizeT len, unsigned int type);
+Register Min(const char *data, MemSizeT len, unsigned int type);
+Register Max(const char *data, MemSizeT len, unsigned int type);
+Register Dot(const char *data1, const char *data2, MemSizeT len, unsigned int type);
+
+// dst[i] += src[i] or dst[i] *= src[i]
+void Add(char *dst, const char *src, MemSizeT len, unsigned int type);
+void Mul(char *dst, const char *src, MemSizeT len, unsigned int type);
+// data[i] += value or data[i] *= value
+void AddScalar(char *data, MemSizeT len, unsigned int type, Register value);
+void MulScalar(char *data, MemSizeT len, unsigned int type, Register value);
+// data[i] = data[0] + ... + data[i]
+void PrefixSum(char *data, MemSizeT len, unsigned int type);
+
+// sort 64-bit integers or doubles in ascending order (stable)
+// NaNs with sign bit are placed at the beginning, other NaNs at the end
+void Sort(Register *data, MemSizeT len, bool is_float);
+// find the value in sorted data, return its index if found,
+// otherwise return (-(insertion point) - 1)
+long long BinarySearch(const Register *data, MemSizeT len, Register value, bool is_float);
+
+} // namespace vecfunc
+
+} // namespace zvm
+
+#endif // ZVM_VECFUNC_H_
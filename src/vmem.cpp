@@ -0,0 +1,279 @@
+#include "vmem.h"
+
+#include <csignal>
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace zvm::vmem;
+
+// offsets that MemSizeT can express, plus the size of a Register
+const std::size_t kGuardSize = (1ULL << (sizeof(zvm::MemSizeT) * 8)) + sizeof(zvm::Register);
+// number of blocks in each reservation of 'BlockPool'
+const std::size_t kBlocksPerReservation = 64;
+
+thread_local FaultScope *current_scope = nullptr;
+struct sigaction old_segv_action, old_bus_action;
+std::once_flag handler_flag;
+
+void HandleFault(int sig, siginfo_t *info, void *context) {
+    auto scope = current_scope;
+    if (scope) {
+        if (scope->memory().Contains(info->si_addr)) siglongjmp(scope->env(), kMemoryFault);
+        if (scope->stack().Contains(info->si_addr)) siglongjmp(scope->env(), kStackFault);
+    }
+    // fault is not caused by VM, restore the previous action
+    // and the instruction will fault again after returning
+    sigaction(sig, sig == SIGSEGV ? &old_segv_action : &old_bus_action, nullptr);
+}
+
+void InstallHandler() {
+    struct sigaction action = {};
+    action.sa_sigaction = HandleFault;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &old_segv_action);
+    sigaction(SIGBUS, &action, &old_bus_action);
+}
+
+const std::size_t page_size = sysconf(_SC_PAGESIZE);
+
+} // namespace
+
+namespace zvm {
+
+namespace vmem {
+
+std::size_t PageSize() {
+    return page_size;
+}
+
+std::size_t AlignToPage(std::size_t size) {
+    return (size + page_size - 1) / page_size * page_size;
+}
+
+bool LazyBlock::Allocate(std::size_t size) {
+    if (data_ && size == size_) {
+        Discard();
+        return true;
+    }
+    Free();
+    if (!size) return true;
+    auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data == MAP_FAILED) return false;
+    data_ = (char *)data;
+    size_ = size;
+    return true;
+}
+
+void LazyBlock::Free() {
+    if (data_) munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void LazyBlock::Discard() {
+    if (data_) madvise(data_, size_, MADV_DONTNEED);
+}
+
+bool GuardedBlock::Allocate(MemSizeT size) {
+    if (base_ && size == size_ && !mapped_) {
+        Discard();
+        return true;
+    }
+    Free();
+    auto commit_size = AlignToPage(size);
+    auto reserved = commit_size + AlignToPage(kGuardSize);
+    // reserve address space only
+    auto base = mmap(nullptr, reserved, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) return false;
+    base_ = (char *)base;
+    reserved_ = reserved;
+    if (commit_size && mprotect(base_, commit_size, PROT_READ | PROT_WRITE)) {
+        Free();
+        return false;
+    }
+    data_ = base_ + commit_size - size;
+    size_ = size;
+    return true;
+}
+
+void GuardedBlock::Discard() {
+    auto commit_size = AlignToPage(size_);
+    if (commit_size) madvise(base_, commit_size, MADV_DONTNEED);
+}
+
+void GuardedBlock::Restore(const char *image, MemSizeT image_size) {
+    if (mapped_) {
+        // discarded pages of a file mapping will not be zero
+        auto size = size_;
+        Allocate(size);
+    }
+    auto commit_size = AlignToPage(size_);
+    if (!commit_size) return;
+    auto page_count = commit_size / page_size;
+    // 'mincore' reports whether pages are in memory
+    std::vector<unsigned char> resident(page_count);
+    if (mincore(base_, commit_size, resident.data())) {
+        Discard();
+        std::fill(resident.begin(), resident.end(), 0);
+    }
+    // give back the runs of pages which are not in memory,
+    // because they may have been swapped out
+    for (std::size_t i = 0, run = 0; i <= page_count; ++i) {
+        if (i < page_count && !(resident[i] & 1)) continue;
+        if (run < i) madvise(base_ + run * page_size, (i - run) * page_size, MADV_DONTNEED);
+        run = i + 1;
+    }
+    if (image_size) memcpy(data_, image, image_size);
+    // clear the rest of pages in memory
+    std::size_t offset = data_ - base_;
+    for (std::size_t i = 0; i < page_count; ++i) {
+        if (!(resident[i] & 1)) continue;
+        auto begin = std::max(i * page_size, offset + image_size);
+        auto end = (i + 1) * page_size;
+        if (begin < end) memset(base_ + begin, 0, end - begin);
+    }
+}
+
+void GuardedBlock::Free() {
+    if (base_ && !pooled_) munmap(base_, reserved_);
+    base_ = data_ = nullptr;
+    reserved_ = 0;
+    size_ = 0;
+    mapped_ = false;
+    pooled_ = false;
+}
+
+bool BlockPool::Acquire(MemSizeT size, GuardedBlock &block) {
+    if (!slot_size_ || size != block_size_) {
+        Clear();
+        block_size_ = size;
+        // one guard page after every block
+        slot_size_ = AlignToPage(size) + page_size;
+    }
+    char *slot;
+    if (!free_list_.empty()) {
+        slot = free_list_.back();
+        free_list_.pop_back();
+    }
+    else {
+        if (reservations_.empty() || next_slot_ == kBlocksPerReservation) {
+            auto reserved = slot_size_ * kBlocksPerReservation;
+            auto base = mmap(nullptr, reserved, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (base == MAP_FAILED) return false;
+            reservations_.push_back({(char *)base, reserved});
+            next_slot_ = 0;
+        }
+        slot = reservations_.back().base + next_slot_ * slot_size_;
+        auto commit_size = slot_size_ - page_size;
+        if (commit_size && mprotect(slot, commit_size, PROT_READ | PROT_WRITE)) return false;
+        ++next_slot_;
+    }
+    block.Free();
+    block.base_ = slot;
+    block.reserved_ = slot_size_;
+    block.data_ = slot + (slot_size_ - page_size) - size;
+    block.size_ = size;
+    block.pooled_ = true;
+    return true;
+}
+
+void BlockPool::Release(GuardedBlock &block, bool discard) {
+    if (!block.pooled_) return;
+    if (discard) block.Discard();
+    free_list_.push_back(block.base_);
+    block.Free();
+}
+
+void BlockPool::Clear() {
+    for (const auto &i : reservations_) munmap(i.base, i.size);
+    reservations_.clear();
+    free_list_.clear();
+    next_slot_ = 0;
+    block_size_ = 0;
+    slot_size_ = 0;
+}
+
+bool MappedFile::Open(const char *path) {
+    Close();
+    auto fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) || file_stat.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    auto data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // mapping is still available after closing the file
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    data_ = (const char *)data;
+    size_ = file_stat.st_size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_) munmap((void *)data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+std::size_t MappedFile::slack() const {
+    return AlignToPage(size_) - size_;
+}
+
+char *MapFileZeroEnded(const char *path, std::size_t &size) {
+    auto fd = open(path, O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) || file_stat.st_size < 0) {
+        close(fd);
+        return nullptr;
+    }
+    size = file_stat.st_size;
+    // reserve one more byte, the rest of last page of file is zero,
+    // or there will be an anonymous zero page after the file
+    auto map_size = AlignToPage(size + 1);
+    auto data = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data != MAP_FAILED && size) {
+        auto file_map = mmap(data, size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_FIXED, fd, 0);
+        if (file_map == MAP_FAILED) {
+            munmap(data, map_size);
+            data = MAP_FAILED;
+        }
+    }
+    close(fd);
+    return data == MAP_FAILED ? nullptr : (char *)data;
+}
+
+void UnmapFile(char *data, std::size_t size) {
+    munmap(data, AlignToPage(size + 1));
+}
+
+FaultScope::FaultScope(const GuardedBlock &memory, const GuardedBlock &stack)
+        : memory_(memory), stack_(stack), prev_(current_scope) {
+    std::call_once(handler_flag, InstallHandler);
+    current_scope = this;
+}
+
+FaultScope::~FaultScope() {
+    current_scope = prev_;
+}
+
+} // namespace vmem
+
+} // namespace zvm
@@ -0,0 +1,228 @@
+#ifndef ZVM_VMEM_H_
+#define ZVM_VMEM_H_
+
+#include <setjmp.h>
+#include <vector>
+#include <cstddef>
+
+#include "type.h"
+
+namespace zvm {
+
+namespace vmem {
+
+std::size_t PageSize();
+std::size_t AlignToPage(std::size_t size);
+
+// anonymous memory whose pages will not be allocated until they are touched
+class LazyBlock {
+public:
+    LazyBlock() : data_(nullptr), size_(0) {}
+    LazyBlock(LazyBlock &&block) noexcept : data_(block.data_), size_(block.size_) {
+        block.data_ = nullptr;
+        block.size_ = 0;
+    }
+    LazyBlock(const LazyBlock &) = delete;
+    ~LazyBlock() { Free(); }
+
+    LazyBlock &operator=(LazyBlock &&block) noexcept {
+        if (this != &block) {
+            Free();
+            data_ = block.data_;
+            size_ = block.size_;
+            block.data_ = nullptr;
+            block.size_ = 0;
+        }
+        return *this;
+    }
+    LazyBlock &operator=(const LazyBlock &) = delete;
+
+    // if size does not change, the previous block will be discarded
+    // instead of being reallocated
+    bool Allocate(std::size_t size);
+    void Free();
+    // give back all pages, block will be filled with zero again
+    void Discard();
+
+    char *get() const { return data_; }
+    char &operator[](std::size_t index) const { return data_[index]; }
+    std::size_t size() const { return size_; }
+
+private:
+    char *data_;
+    std::size_t size_;
+};
+
+// a block of memory followed by a PROT_NONE guard region
+// the end of block is aligned to the guard region, and the guard region
+// covers all offsets that MemSizeT can express, so accessing 'block[index]'
+// (or a Register at 'index') where 'index >= size' will always trap
+// blocks taken from 'BlockPool' only have a guard page instead
+class GuardedBlock {
+public:
+    GuardedBlock()
+            : base_(nullptr), data_(nullptr), reserved_(0), size_(0),
+              mapped_(false), pooled_(false) {}
+    GuardedBlock(GuardedBlock &&block) noexcept
+            : base_(block.base_), data_(block.data_), reserved_(block.reserved_),
+              size_(block.size_), mapped_(block.mapped_), pooled_(block.pooled_) {
+        block.base_ = block.data_ = nullptr;
+        block.reserved_ = 0;
+        block.size_ = 0;
+        block.mapped_ = false;
+        block.pooled_ = false;
+    }
+    GuardedBlock(const GuardedBlock &) = delete;
+    ~GuardedBlock() { Free(); }
+
+    GuardedBlock &operator=(GuardedBlock &&block) noexcept {
+        if (this != &block) {
+            Free();
+            base_ = block.base_;
+            data_ = block.data_;
+            reserved_ = block.reserved_;
+            size_ = block.size_;
+            mapped_ = block.mapped_;
+            pooled_ = block.pooled_;
+            block.base_ = block.data_ = nullptr;
+            block.reserved_ = 0;
+            block.size_ = 0;
+            block.mapped_ = false;
+            block.pooled_ = false;
+        }
+        return *this;
+    }
+    GuardedBlock &operator=(const GuardedBlock &) = delete;
+
+    // if size does not change, the previous block will be discarded
+    // instead of being reallocated
+    bool Allocate(MemSizeT size);
+    void Free();
+    // give back all pages, block will be filled with zero again
+    void Discard();
+    // fill block with 'image' and then zero, only pages that have been
+    // touched are written, the others are given back to system
+    void Restore(const char *image, MemSizeT image_size);
+
+    // if address is in the whole reservation (including guard region)
+    bool Contains(const void *address) const {
+        auto addr = (const char *)address;
+        return addr >= base_ && addr < base_ + reserved_;
+    }
+
+    char *get() const { return data_; }
+    char &operator[](MemSizeT index) const { return data_[index]; }
+    MemSizeT size() const { return size_; }
+    // pages that hold the block, which are aligned to page
+    char *pages() const { return base_; }
+    std::size_t pages_size() const { return AlignToPage(size_); }
+    // pages have been replaced by a file mapping, which will be
+    // dropped when the block is restored
+    void MarkMapped() { mapped_ = true; }
+
+private:
+    friend class BlockPool;
+
+    char *base_, *data_;
+    std::size_t reserved_;
+    MemSizeT size_;
+    bool mapped_;
+    // pages belong to a 'BlockPool', they are not unmapped by 'Free'
+    bool pooled_;
+};
+
+// blocks of the same size that are carved from large reservations, so that
+// a lot of them can be allocated without a guard region for each block
+// every block is followed by a single guard page, only accessing right
+// after the end of block will trap, other offsets must be kept in range
+// by the user of block
+class BlockPool {
+public:
+    BlockPool() : block_size_(0), slot_size_(0), next_slot_(0) {}
+    BlockPool(const BlockPool &) = delete;
+    BlockPool &operator=(const BlockPool &) = delete;
+    ~BlockPool() { Clear(); }
+
+    // take a block of 'size', return false if failed
+    // all blocks must have been given back before 'size' changes
+    bool Acquire(MemSizeT size, GuardedBlock &block);
+    // give back a block, its pages are also given back to system if
+    // 'discard' is true, otherwise they will be reused as they are
+    void Release(GuardedBlock &block, bool discard);
+    // unmap all reservations, all blocks must have been given back
+    void Clear();
+
+    // number of blocks that have been given back and can be reused
+    std::size_t free_count() const { return free_list_.size(); }
+
+private:
+    struct Reservation {
+        char *base;
+        std::size_t size;
+    };
+
+    MemSizeT block_size_;
+    std::size_t slot_size_;
+    std::vector<Reservation> reservations_;
+    // slots in the last reservation that have never been used
+    std::size_t next_slot_;
+    std::vector<char *> free_list_;
+};
+
+// read-only mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() : data_(nullptr), size_(0) {}
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { Close(); }
+
+    // previous file will be closed, empty file can not be mapped
+    bool Open(const char *path);
+    void Close();
+
+    const char *data() const { return data_; }
+    std::size_t size() const { return size_; }
+    // bytes that can be read after the end of file (filled with zero)
+    std::size_t slack() const;
+
+private:
+    const char *data_;
+    std::size_t size_;
+};
+
+// private mapping of a whole file followed by at least one zero byte,
+// written pages are copied, so the file will never be modified
+// 'size' is the size of file, return nullptr if failed
+char *MapFileZeroEnded(const char *path, std::size_t &size);
+void UnmapFile(char *data, std::size_t size);
+
+enum FaultType {
+    kNoFault, kMemoryFault, kStackFault
+};
+
+// while a scope is alive, accessing the guard region of 'memory' or
+// 'stack' in current thread will jump back to 'env' with the fault type
+// scopes can be nested, only the innermost one takes effect
+class FaultScope {
+public:
+    FaultScope(const GuardedBlock &memory, const GuardedBlock &stack);
+    FaultScope(const FaultScope &) = delete;
+    FaultScope &operator=(const FaultScope &) = delete;
+    ~FaultScope();
+
+    sigjmp_buf &env() { return env_; }
+    const GuardedBlock &memory() const { return memory_; }
+    const GuardedBlock &stack() const { return stack_; }
+
+private:
+    sigjmp_buf env_;
+    const GuardedBlock &memory_, &stack_;
+    FaultScope *prev_;
+};
+
+} // namespace vmem
+
+} // namespace zvm
+
+#endif // ZVM_VMEM_H_
@@ -0,0 +1,47 @@
+#include "vmpool.h"
+
+namespace zvm {
+
+std::unique_ptr<ZexVM> VMPool::NewInstance() {
+    auto vm = std::make_unique<ZexVM>(gc_pool_size_, int_manager_);
+    if (!vm->LoadProgram(program_)) return nullptr;
+    return vm;
+}
+
+bool VMPool::Reserve(std::size_t count) {
+    std::vector<std::unique_ptr<ZexVM>> new_list;
+    for (std::size_t i = idle_count(); i < count; ++i) {
+        auto vm = NewInstance();
+        if (!vm) return false;
+        new_list.push_back(std::move(vm));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &&i : new_list) idle_list_.push_back(std::move(i));
+    return true;
+}
+
+std::unique_ptr<ZexVM> VMPool::Acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_list_.empty()) {
+            auto vm = std::move(idle_list_.back());
+            idle_list_.pop_back();
+            return vm;
+        }
+    }
+    return NewInstance();
+}
+
+void VMPool::Release(std::unique_ptr<ZexVM> vm) {
+    // instance that can not be reset will be destroyed
+    if (!vm || vm->program() != program_ || !vm->Reset()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_list_.push_back(std::move(vm));
+}
+
+std::size_t VMPool::idle_count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_list_.size();
+}
+
+} // namespace zvm
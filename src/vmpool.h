@@ -0,0 +1,52 @@
+#ifndef ZVM_VMPOOL_H_
+#define ZVM_VMPOOL_H_
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+#include "type.h"
+#include "program.h"
+#include "interrupt.h"
+#include "zvm.h"
+
+namespace zvm {
+
+// pool of VM instances that run the same program
+// instances are reset when they are given back, so they can be
+// handed out again without allocating or loading anything
+// all methods are thread-safe
+class VMPool {
+public:
+    VMPool(std::shared_ptr<const Program> program, InterruptManager &int_manager,
+           PoolSizeT gc_pool_size = kGCPoolSize)
+            : program_(std::move(program)), int_manager_(int_manager),
+              gc_pool_size_(gc_pool_size) {}
+    VMPool(const VMPool &) = delete;
+    VMPool &operator=(const VMPool &) = delete;
+    ~VMPool() {}
+
+    // create instances in advance, return false if failed
+    bool Reserve(std::size_t count);
+    // get an instance that is ready to run, return nullptr if failed
+    std::unique_ptr<ZexVM> Acquire();
+    // reset the instance and put it back to pool
+    void Release(std::unique_ptr<ZexVM> vm);
+
+    std::size_t idle_count();
+    const std::shared_ptr<const Program> &program() const { return program_; }
+
+private:
+    std::unique_ptr<ZexVM> NewInstance();
+
+    std::shared_ptr<const Program> program_;
+    InterruptManager &int_manager_;
+    PoolSizeT gc_pool_size_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ZexVM>> idle_list_;
+};
+
+} // namespace zvm
+
+#endif // ZVM_VMPOOL_H_
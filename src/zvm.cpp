@@ -6,6 +6,10 @@
 #include <string>
 #include <cstring>
 #include <memory>
+#include <algorithm>
+
+#include "strfunc.h"
+#include "snapshot.h"
 
 namespace {
 
@@ -20,7 +24,12 @@ enum InstOp {
     // SETR (set root), ADR (add ref), RMR (remove ref)
     ITF, FTI, ITS, STI, FTS, STF,   // Convert
     ADDS, CPS, LENS, EQS, GETS, SETS,   // String
-    ADDL, CPL, LENL, EQL, GETL, SETL   // List
+    ADDL, CPL, LENL, EQL, GETL, SETL,   // List
+    FINDS, SPLITS,   // String (extension)
+    NEWB, GETB, SETB, LENB,   // Buffer
+    NEWM, GETM, SETM, DELM, LENM, HASM, NEXTM,   // Map
+    SORTL, BSEARCHL,   // List (extension)
+    SPAWN, YIELD, JOIN   // Fiber
 };
 
 enum InstReg {
@@ -88,59 +97,47 @@ inline T CalcExpression(const T &opr1, const T &opr2, int Op) {
 namespace zvm {
 
 void ZexVM::Initialize() {
+    scheduler_.Clear();
     program_error_ = true;
     reg_.fill({0});
-    cache_.fill(0);
+    program_.reset();
+    cache_ = nullptr;
+    cache_size_ = 0;
+    break_pc_ = -1;
     if (mem_.mem_error()) mem_.ResetMemory();
 }
 
-bool ZexVM::LoadProgram(std::ifstream &file) {
+bool ZexVM::LoadProgram(const char *path) {
+    return LoadProgram(Program::Load(path));
+}
+
+bool ZexVM::LoadProgram(std::shared_ptr<const Program> program) {
     Initialize();
 
-    if (!file.is_open()) return false;
-
-    auto current = file.tellg();   // save current position
-    file.seekg(0, std::ios::end);
-    auto len = file.tellg();
-    file.seekg(current);   // restore saved position
-    if (len < kBytecodeHeaderLength) return false;
-    
-    file >> std::noskipws;
-
-    char header[3], version[2];
-    file >> header[0] >> header[1] >> header[2];
-    file >> version[0] >> version[1];
-    if (header[0] != '\x93' || header[1] != '\x94' || header[2] != '\x86') return false;
-    if (version[0] > kCurrentVersion[0] || version[0] < kMinimumVersion[0]) {
-        return false;
-    }
-    else if(version[1] > kCurrentVersion[1] || version[0] < kMinimumVersion[0]) {
-        return false;
-    }
-
-    MemSizeT mem_size = 0, stack_size = 0, const_pool_size = 0, temp = 0;
-    file.read((char *)&mem_size, sizeof(MemSizeT));
-    file.read((char *)&stack_size, sizeof(MemSizeT));
-    file.read((char *)&const_pool_size, sizeof(MemSizeT));
-    file.read((char *)&temp, sizeof(MemSizeT));
-    const_pool_size = temp - const_pool_size;
-    if (const_pool_size >= mem_size) return false;
-    mem_.set_memory_size(mem_size);
-    mem_.set_stack_size(stack_size);
+    if (!program) return false;
+    mem_.set_memory_size(program->memory_size());
+    mem_.set_stack_size(program->stack_size());
+    mem_.set_const_pool(program->const_pool(), program->const_pool_size());
     mem_.ResetMemory();
+    if (mem_.mem_error()) return false;
 
-    for (int i = 0; i < const_pool_size; ++i) {
-        file >> mem_[i];
-    }
-
-    if ((MemSizeT)len - temp >= kCacheSize) return false;
-    for (int i = 0; !file.eof(); ++i) {
-        file >> cache_[i];
-    }
+    memcpy(&mem_[0], program->const_pool(), program->const_pool_size());
+    cache_ = program->code();
+    cache_size_ = program->code_size();
+    program_ = std::move(program);
 
     return !(program_error_ = false);
 }
 
+bool ZexVM::Reset() {
+    if (!program_) return false;
+    scheduler_.Clear();
+    io_.Reset();
+    reg_.fill({0});
+    mem_.RestoreMemory(program_->const_pool(), program_->const_pool_size());
+    return !(program_error_ = mem_.mem_error());
+}
+
 bool ZexVM::SetStartupArguments(const std::vector<std::string> &arg_list) {
     ZValue temp;
     if (arg_list.empty()) {
@@ -166,20 +163,112 @@ bool ZexVM::SetStartupArguments(const std::vector<std::string> &arg_list) {
     return true;
 }
 
+bool ZexVM::SaveSnapshot(const char *path) {
+    if (program_error_ || scheduler_.active()) return false;
+    snapshot::ImageWriter writer;
+    if (!writer.Open(path)) return false;
+
+    snapshot::ImageHeader header = {};
+    header.code_size = cache_size_;
+    header.code_offset = writer.WriteSection(cache_, cache_size_);
+    const char padding[kCodePadding] = {0};
+    writer.Append(padding, kCodePadding);
+    header.const_pool_size = program_->const_pool_size();
+    header.const_pool_offset = writer.WriteSection(program_->const_pool(), program_->const_pool_size());
+    if (!mem_.SaveState(writer, header)) return false;
+    std::copy(reg_.begin(), reg_.end(), header.reg);
+    return writer.Finish(header);
+}
+
+bool ZexVM::LoadSnapshot(const char *path) {
+    Initialize();
+
+    snapshot::ImageReader reader;
+    if (!reader.Open(path)) return false;
+    auto program = Program::LoadImage(path);
+    if (!program) return false;
+    if (!mem_.LoadState(reader)) return false;
+    mem_.set_const_pool(program->const_pool(), program->const_pool_size());
+
+    const auto &header = reader.header();
+    std::copy(header.reg, header.reg + kRegisterCount, reg_.begin());
+    cache_ = program->code();
+    cache_size_ = program->code_size();
+    program_ = std::move(program);
+
+    return !(program_error_ = false);
+}
+
 int ZexVM::Run() {
+    return RunProgram(false);
+}
+
+int ZexVM::RunUntil(long long break_pc) {
+    break_pc_ = break_pc;
+    return RunProgram(true);
+}
+
+int ZexVM::RunProgram(bool break_mode) {
+    if (program_error_) return kProgramError;
+    scheduler_.Resume();
+
+    // accessing the guard region of memory or stack will jump back here
+    vmem::FaultScope fault_scope(mem_.memory_block(), mem_.stack_block());
+    int ret;
+    switch (sigsetjmp(fault_scope.env(), 1)) {
+        case vmem::kMemoryFault: {
+            mem_.set_mem_error();
+            program_error_ = true;
+            ret = kMemoryError;
+            break;
+        }
+        case vmem::kStackFault: {
+            mem_.set_mem_error();
+            program_error_ = true;
+            ret = kStackError;
+            break;
+        }
+        default: {
+            ret = break_mode ? Execute<true>() : Execute<false>();
+            break;
+        }
+    }
+    // buffered output is written when program stops
+    io_.Flush();
+    return ret;
+}
+
+template <bool kBreakMode>
+int ZexVM::Execute() {
 #define reg_x reg_[rx_index]
 #define reg_y reg_[ry_index]
-#define NEXT(inst_len) SwitchInst(inst_len); \
-        if (reg_pc >= kCacheSize) goto _PERR; \
+// third register of 'itRRR' instructions, masked like the others
+#define reg_z reg_[*(unsigned char *)(cache_ + reg_pc + itRR) & 0x0F]
+#define NEXT(inst_len) if (!SwitchInst(inst_len)) goto _PERR; \
+        if (kBreakMode && reg_pc == break_pc_) goto _BREAK; \
         goto *inst_list[inst->op]
-
-    if (program_error_) return kProgramError;
+// jump to 'target', a backward branch consumes the time slice of fiber
+#define BRANCH(target) do { \
+            auto target_pc = (long long)(target); \
+            if (target_pc <= reg_pc && --slice < 0) { reg_pc = target_pc; goto _PREEMPT; } \
+            reg_pc = target_pc; \
+            NEXT(0); \
+        } while (0)
+// continue running the fiber that scheduler has loaded
+#define SWITCHED(result) do { \
+            auto switch_result = (result); \
+            if (switch_result == Scheduler::kSuspend) return kSuspended; \
+            if (switch_result == Scheduler::kDeadlock) goto _PERR; \
+            slice = kFiberSlice; \
+            NEXT(0); \
+        } while (0)
 
     VMInst *inst = nullptr;
     ZValue temp;
     auto &reg_pc = reg_[PC].long_long;
     auto rx_index = 0, ry_index = 0;
     auto imm_mode = false;
+    auto slice = kFiberSlice;
 
     void *inst_list[] = {
         &&_END,
@@ -191,23 +280,37 @@ int ZexVM::Run() {
         &&_NEWS, &&_NEWL, &&_NEWF, &&_DELS, &&_DELL, &&_SETR, &&_ADR, &&_RMR,
         &&_ITF, &&_FTI, &&_ITS, &&_STI, &&_FTS, &&_STF,
         &&_ADDS, &&_CPS, &&_LENS, &&_EQS, &&_GETS, &&_SETS,
-        &&_ADDL, &&_CPL, &&_LENL, &&_EQL, &&_GETL, &&_SETL
+        &&_ADDL, &&_CPL, &&_LENL, &&_EQL, &&_GETL, &&_SETL,
+        &&_FINDS, &&_SPLITS,
+        &&_NEWB, &&_GETB, &&_SETB, &&_LENB,
+        &&_NEWM, &&_GETM, &&_SETM, &&_DELM, &&_LENM, &&_HASM, &&_NEXTM,
+        &&_SORTL, &&_BSEARCHL,
+        &&_SPAWN, &&_YIELD, &&_JOIN
     };
 
+    // return false if PC is out of code, which must be checked before
+    // decoding, only 'kCodePadding' bytes can be read after the code
     auto SwitchInst = [&](MemSizeT inst_len) {
         reg_pc += inst_len;
-        inst = (VMInst *)(cache_.data() + reg_pc);
+        if ((unsigned long long)reg_pc >= cache_size_) return false;
+        inst = (VMInst *)(cache_ + reg_pc);
         rx_index = inst->reg >> 4;
         ry_index = inst->reg & 0x0F;
         imm_mode = !(inst->reg & 0x0F);
+        return true;
     };
 
     NEXT(0);   // start running
 
-    _PERR: program_error_ = true; return kProgramError;
-    _SERR: program_error_ = true; return kStackError;
+    _PERR: {
+        // returned from the function of a fiber
+        if (reg_pc == kFiberReturn && scheduler_.active()) SWITCHED(scheduler_.Exit());
+        program_error_ = true;
+        return kProgramError;
+    }
     _MERR: program_error_ = true; return kMemoryError;
     _CERR: program_error_ = true; return kCacheError;
+    _BREAK: return kBreakpoint;
     _END: {
         return kFinished;
     }
@@ -233,13 +336,11 @@ int ZexVM::Run() {
         NEXT(itR);
     }
     _JMP: {
-        reg_pc = imm_mode ? inst->imm.int_val : reg_x.long_long;
-        NEXT(0);
+        BRANCH(imm_mode ? inst->imm.int_val : reg_x.long_long);
     }
     _JZ: {
         if (reg_x.long_long == 0) {
-            reg_pc = imm_mode ? inst->imm.int_val : reg_x.long_long;
-            NEXT(0);
+            BRANCH(imm_mode ? inst->imm.int_val : reg_x.long_long);
         }
         else {
             NEXT(imm_mode ? itRI : itRR);
@@ -247,8 +348,7 @@ int ZexVM::Run() {
     }
     _JNZ: {
         if (reg_x.long_long != 0) {
-            reg_pc = imm_mode ? inst->imm.int_val : reg_x.long_long;
-            NEXT(0);
+            BRANCH(imm_mode ? inst->imm.int_val : reg_x.long_long);
         }
         else {
             NEXT(imm_mode ? itRI : itRR);
@@ -264,13 +364,12 @@ int ZexVM::Run() {
             reg_[RV] = temp.num;   // save env list to RV
             reg_pc += itR;
         }
-        if (!mem_.Push(reg_[PC])) goto _SERR;
+        mem_.Push(reg_[PC]);
         reg_pc = temp.func.position;
         NEXT(0);
     }
     _RET: {
         reg_pc = mem_.Pop().long_long;
-        if (mem_.mem_error()) goto _SERR;
         NEXT(0);
     }
     _MOV: {
@@ -284,54 +383,53 @@ int ZexVM::Run() {
     }
     _POP: {
         reg_x = mem_.Pop();
-        if (mem_.mem_error()) goto _SERR;
         NEXT(itR);
     }
     _PUSH: {
         temp.num.long_long = inst->imm.int_val;
-        if (!mem_.Push(imm_mode ? temp.num : reg_x)) goto _SERR;
+        mem_.Push(imm_mode ? temp.num : reg_x);
         NEXT(imm_mode ? itRI : itR);
     }
     _PEEK: {
         reg_x = mem_.Peek(reg_x.long_long);
-        if (mem_.mem_error()) goto _MERR;
         NEXT(itR);
     }
     _LD: {
         temp.num.long_long = imm_mode ? inst->imm.int_val : reg_y.long_long;
         reg_x = mem_(temp.num.long_long);
-        if (mem_.mem_error()) goto _MERR;
         NEXT(imm_mode ? itRI : itRR);
     }
     _ST: {
         // ST: I, R/I;   inst->imm -> I, reg_x/temp.num -> R/I
         if (imm_mode) {
-            temp.num.long_long = *(unsigned int *)(cache_.data() + reg_pc + itRI);
+            temp.num.long_long = *(unsigned int *)(cache_ + reg_pc + itRI);
             mem_(inst->imm.int_val) = temp.num;
-            if (mem_.mem_error()) goto _MERR;
             NEXT(itII);
         }
         else {
             mem_(inst->imm.int_val) = reg_x;
-            if (mem_.mem_error()) goto _MERR;
             NEXT(itRI);
         }
     }
     _STR: {
         temp.num.long_long = inst->imm.int_val;
         mem_(reg_x.long_long) = imm_mode ? temp.num : reg_y;
-        if (mem_.mem_error()) goto _MERR;
         NEXT(imm_mode ? itRI : itRR);
     }
     _STC: {
         mem_[reg_x.long_long] = (char)(imm_mode ? inst->imm.int_val : reg_y.long_long);
-        if (mem_.mem_error()) goto _MERR;
         NEXT(imm_mode ? itRI : itRR);
     }
     _INT: {
-        auto opr = *(unsigned int *)(cache_.data() + reg_pc + itVOID);
-        if (!int_manager_.TriggerInterrupt(opr, reg_, mem_)) goto _PERR;
+        auto opr = *(unsigned int *)(cache_ + reg_pc + itVOID);
+        if (!int_manager_.TriggerInterrupt(opr, reg_, mem_, io_)) goto _PERR;
         if (mem_.mem_error()) goto _MERR;
+        // PC stays here, so the interrupt will be triggered again
+        if (io_.TakeSuspend()) {
+            if (!scheduler_.active()) return kSuspended;
+            // other fibers can run while waiting
+            SWITCHED(scheduler_.WaitIO(reg_[A1].long_long));
+        }
         NEXT(itI);
     }
     _NEWS: {
@@ -389,27 +487,29 @@ int ZexVM::Run() {
         NEXT(itR);
     }
     _ITS: _FTS: {
-        std::string str;
+        char buffer[strfunc::kNumberBufferSize];
+        MemSizeT len;
         if (inst->op == ITS) {
-            str = std::to_string(reg_y.long_long);
+            len = strfunc::FormatInteger(reg_y.long_long, buffer);
         }
         else {
-            str = std::to_string(reg_y.doub);
+            len = strfunc::FormatFloat(reg_y.doub, buffer);
         }
         temp.num = reg_x;
-        if (!mem_.SetRawString(temp.str, str.c_str())) goto _MERR;
+        if (!mem_.SetRawString(temp.str, buffer, len)) goto _MERR;
         reg_x = temp.num;
     }
     NEXT(itRR);
     _STI: _STF: {
         temp.num = reg_y;
-        auto ptr = mem_.GetRawString(temp.str);
+        MemSizeT len;
+        auto ptr = mem_.GetRawString(temp.str, len);
         if (mem_.mem_error()) goto _MERR;
         if (inst->op == STI) {
-            reg_x.long_long = strtoll(ptr, nullptr, 10);
+            reg_x.long_long = strfunc::ParseInteger(ptr, len);
         }
         else {
-            reg_x.doub = strtod(ptr, nullptr);
+            reg_x.doub = strfunc::ParseFloat(ptr, len);
         }
         NEXT(itRR);
     }
@@ -485,13 +585,152 @@ int ZexVM::Run() {
     _SETL: {
         temp.num = reg_x;
         ZValue opr = {reg_y};
-        if (!mem_.SetListItem(temp.list, opr.num.long_long, reg_[*(char *)(cache_.data() + reg_pc + itRR)])) goto _MERR;
+        if (!mem_.SetListItem(temp.list, opr.num.long_long, reg_z)) goto _MERR;
     }
     NEXT(itRRR);
+    _FINDS: {
+        temp.num = reg_x;
+        if (imm_mode) {
+            reg_x.long_long = mem_.StringFind(temp.str, (char)inst->imm.int_val);
+        }
+        else {
+            ZValue opr = {reg_y};
+            reg_x.long_long = mem_.StringFind(temp.str, opr.str);
+        }
+        if (mem_.mem_error()) goto _MERR;
+        NEXT(imm_mode ? itRI : itRR);
+    }
+    _SPLITS: {
+        temp.num = reg_x;
+        if (imm_mode) {
+            temp.list = mem_.StringSplit(temp.str, (char)inst->imm.int_val);
+        }
+        else {
+            ZValue opr = {reg_y};
+            temp.list = mem_.StringSplit(temp.str, opr.str);
+        }
+        if (mem_.mem_error()) goto _MERR;
+        reg_x = temp.num;
+        NEXT(imm_mode ? itRI : itRR);
+    }
+    _NEWB: {
+        auto type = (unsigned long long)reg_x.long_long;
+        auto length = (unsigned long long)(imm_mode ? inst->imm.int_val : reg_y.long_long);
+        // out-of-range type or length should not be truncated
+        if (type > 0xFFFFFFFF || length > (MemSizeT)-1) goto _MERR;
+        temp.buf = mem_.AddBufferObj(type, length);
+        if (mem_.mem_error()) goto _MERR;
+        reg_x = temp.num;
+        NEXT(imm_mode ? itRI : itRR);
+    }
+    _GETB: {
+        temp.num = reg_y;
+        reg_x = mem_.GetBufferItem(temp.buf, reg_x.long_long);
+        if (mem_.mem_error()) goto _MERR;
+        NEXT(itRR);
+    }
+    _SETB: {
+        temp.num = reg_x;
+        ZValue opr = {reg_y};
+        if (!mem_.SetBufferItem(temp.buf, opr.num.long_long, reg_z)) goto _MERR;
+    }
+    NEXT(itRRR);
+    _LENB: {
+        temp.num = reg_y;
+        reg_x.long_long = mem_.BufferLength(temp.buf);
+        if (mem_.mem_error()) goto _MERR;
+        NEXT(itRR);
+    }
+    _NEWM: {
+        temp.map = mem_.AddMapObj(imm_mode ? inst->imm.int_val : reg_y.long_long);
+        if (mem_.mem_error()) goto _MERR;
+        reg_x = temp.num;
+        NEXT(imm_mode ? itRI : itRR);
+    }
+    _GETM: _HASM: {
+        temp.num = reg_y;
+        if (inst->op == GETM) {
+            reg_x = mem_.MapGet(temp.map, reg_x);
+        }
+        else {
+            reg_x.long_long = mem_.MapContains(temp.map, reg_x);
+        }
+        if (mem_.mem_error()) goto _MERR;
+        NEXT(itRR);
+    }
+    _SETM: {
+        temp.num = reg_x;
+        ZValue opr = {reg_y};
+        if (!mem_.MapSet(temp.map, opr.num, reg_z)) goto _MERR;
+    }
+    NEXT(itRRR);
+    _DELM: {
+        temp.num = reg_x;
+        if (!mem_.MapDelete(temp.map, reg_y)) goto _MERR;
+        NEXT(itRR);
+    }
+    _LENM: {
+        temp.num = reg_y;
+        reg_x.long_long = mem_.MapLength(temp.map);
+        if (mem_.mem_error()) goto _MERR;
+        NEXT(itRR);
+    }
+    _NEXTM: {
+        temp.num = reg_y;
+        auto &key = reg_z;
+        reg_x.long_long = mem_.MapNext(temp.map, reg_x.long_long, key);
+        if (mem_.mem_error()) goto _MERR;
+    }
+    NEXT(itRRR);
+    _SORTL: {
+        temp.num = reg_x;
+        if (!mem_.ListSort(temp.list, imm_mode ? inst->imm.int_val : reg_y.long_long)) goto _MERR;
+        NEXT(imm_mode ? itRI : itRR);
+    }
+    _BSEARCHL: {
+        temp.num = reg_y;
+        auto mode = reg_z.long_long;
+        reg_x.long_long = mem_.ListSearch(temp.list, reg_x, mode);
+        if (mem_.mem_error()) goto _MERR;
+    }
+    NEXT(itRRR);
+    _SPAWN: {
+        // same as CALL, the new fiber gets a copy of registers
+        if (imm_mode) {
+            temp.func.position = inst->imm.int_val;
+            reg_pc += itRI;
+        }
+        else {
+            temp.num.doub = reg_x.doub;
+            reg_pc += itR;
+        }
+        auto id = scheduler_.Spawn(temp.func.position, imm_mode ? reg_[RV] : temp.num);
+        if (!id) goto _MERR;
+        reg_[RV].long_long = id;
+        NEXT(0);
+    }
+    _YIELD: {
+        reg_pc += itVOID;
+        scheduler_.Yield();
+        slice = kFiberSlice;
+        NEXT(0);
+    }
+    _JOIN: {
+        reg_pc += itR;
+        SWITCHED(scheduler_.Join(reg_x.long_long, rx_index));
+    }
+    _PREEMPT: {
+        slice = kFiberSlice;
+        if (scheduler_.has_ready()) scheduler_.Yield();
+        NEXT(0);
+    }
 
 #undef reg_x
 #undef reg_y
+#undef reg_z
 #undef NEXT
+#undef BRANCH
+#undef SWITCHED
 }
 
 } // namespace zvm
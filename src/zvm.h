@@ -1,36 +1,66 @@
 #ifndef ZVM_ZVM_H_
 #define ZVM_ZVM_H_
 
-#include <fstream>
 #include <array>
 #include <vector>
+#include <string>
+#include <memory>
 
 #include "type.h"
 #include "memman.h"
 #include "interrupt.h"
+#include "ioman.h"
+#include "program.h"
+#include "fiber.h"
 
 namespace zvm {
 
 class ZexVM {
 public:
-    ZexVM(MemSizeT gc_pool_size, InterruptManager &int_manager)
-            : mem_(gc_pool_size), int_manager_(int_manager) { Initialize(); }
+    ZexVM(PoolSizeT gc_pool_size, InterruptManager &int_manager)
+            : mem_(gc_pool_size), int_manager_(int_manager),
+              scheduler_(reg_, mem_, io_.async()) { Initialize(); }
     ~ZexVM() {}
 
-    bool LoadProgram(std::ifstream &file);
+    bool LoadProgram(const char *path);
+    // program can be shared with other VM instances
+    bool LoadProgram(std::shared_ptr<const Program> program);
+    // restore VM to the state right after the program was loaded,
+    // I/O state of the last run is dropped and the mailbox is detached
+    bool Reset();
     bool SetStartupArguments(const std::vector<std::string> &arg_list);
+    // return 'kSuspended' if program is waiting for asynchronous
+    // operations, and it can be resumed by calling 'Run' again
     int Run();
+    // stop when PC reaches 'break_pc', return 'kBreakpoint' if reached
+    int RunUntil(long long break_pc);
+    // save the running state to an image file, or restore from it
+    // a program that has spawned fibers can not be saved
+    bool SaveSnapshot(const char *path);
+    bool LoadSnapshot(const char *path);
 
     bool program_error() const { return program_error_; }
+    const std::shared_ptr<const Program> &program() const { return program_; }
+    IOManager &io() { return io_; }
 
 private:
     void Initialize();
+    // run the program and catch the faults
+    int RunProgram(bool break_mode);
+    // execute the program without catching the faults
+    template <bool kBreakMode>
+    int Execute();
 
     bool program_error_;
     std::array<Register, kRegisterCount> reg_;
-    std::array<char, kCacheSize> cache_;
+    std::shared_ptr<const Program> program_;
+    const char *cache_;   // code of program
+    MemSizeT cache_size_;
+    long long break_pc_;
     MemoryManager mem_;
+    IOManager io_;
     InterruptManager &int_manager_;
+    Scheduler scheduler_;
 };
 
 } // namespace zvm
@@ -0,0 +1,102 @@
+# Loopback benchmark of 'echo.zasm'
+# usage: python3 echo_bench.py [zvm] [address] [connections] [requests]
+#   zvm:         path of zvm (default: ../build/zvm)
+#   address:     "<IPv4 address>:<port>" or "unix:<path>"
+#                (default: 127.0.0.1:7878)
+#   connections: number of concurrent connections (default: 64)
+#   requests:    number of requests per connection (default: 1000)
+# every connection sends one request at a time, and waits for the reply
+
+import os
+import selectors
+import socket
+import subprocess
+import sys
+import time
+
+MESSAGE = b'ping 0123456789abcdefghijklmnopq\n'
+
+
+def connect(address):
+	if address.startswith('unix:'):
+		sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+		sock.connect(address[5:])
+	else:
+		host, port = address.rsplit(':', 1)
+		sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+		sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+		sock.connect((host, int(port)))
+	return sock
+
+
+def wait_server(address):
+	for _ in range(100):
+		try:
+			return connect(address)
+		except OSError:
+			time.sleep(0.05)
+	raise RuntimeError('server is not running')
+
+
+def percentile(sorted_list, p):
+	index = min(len(sorted_list) - 1, int(len(sorted_list) * p / 100))
+	return sorted_list[index]
+
+
+def main():
+	base_dir = os.path.dirname(os.path.abspath(__file__))
+	zvm = sys.argv[1] if len(sys.argv) > 1 else os.path.join(base_dir, '../build/zvm')
+	address = sys.argv[2] if len(sys.argv) > 2 else '127.0.0.1:7878'
+	conn_count = int(sys.argv[3]) if len(sys.argv) > 3 else 64
+	req_count = int(sys.argv[4]) if len(sys.argv) > 4 else 1000
+
+	server = subprocess.Popen([zvm, os.path.join(base_dir, 'echo.zbc'), '-a', address])
+	conns = [wait_server(address)]
+	conns += [connect(address) for _ in range(conn_count - 1)]
+
+	sel = selectors.DefaultSelector()
+	remaining, received, sent_time = {}, {}, {}
+	latency = []
+	start = time.perf_counter()
+	for sock in conns:
+		sock.setblocking(False)
+		sel.register(sock, selectors.EVENT_READ)
+		remaining[sock] = req_count
+		received[sock] = 0
+		sent_time[sock] = time.perf_counter_ns()
+		sock.sendall(MESSAGE)
+	active = len(conns)
+	while active:
+		for key, _ in sel.select():
+			sock = key.fileobj
+			received[sock] += len(sock.recv(4096))
+			if received[sock] < len(MESSAGE):
+				continue
+			now = time.perf_counter_ns()
+			latency.append(now - sent_time[sock])
+			received[sock] = 0
+			remaining[sock] -= 1
+			if remaining[sock]:
+				sent_time[sock] = now
+				sock.sendall(MESSAGE)
+			else:
+				sel.unregister(sock)
+				sock.close()
+				active -= 1
+	elapsed = time.perf_counter() - start
+
+	quit_conn = connect(address)
+	quit_conn.sendall(b'quit\n')
+	quit_conn.close()
+	server.wait()
+
+	latency.sort()
+	print('connections: %d, requests: %d' % (conn_count, len(latency)))
+	print('requests/sec: %.0f' % (len(latency) / elapsed))
+	print('latency (us): p50 %.1f, p90 %.1f, p99 %.1f, max %.1f' % (
+		percentile(latency, 50) / 1000, percentile(latency, 90) / 1000,
+		percentile(latency, 99) / 1000, latency[-1] / 1000))
+
+
+if __name__ == '__main__':
+	main()
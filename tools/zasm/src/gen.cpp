@@ -66,13 +66,14 @@ int op_type[] = {
     kReg, kIntImm, kIntImm, kReg, kReg, kReg, kRegReg, kRegReg,
     kReg, kReg, kRegReg, kRegReg, kRegReg, kRegReg,
     kRegReg, kRegReg, kRegReg, kRegReg, kRegReg, kRegReg,
-    kRegReg, kRegReg, kRegReg, kRegReg, kRegReg, kSETL
+    kRegReg, kRegReg, kRegReg, kRegReg, kRegReg, kSETL,
+    kIntImm, kIntImm,
+    kIntImm, kRegReg, kSETL, kRegReg,
+    kIntImm, kRegReg, kSETL, kRegReg, kRegReg, kRegReg, kSETL,
+    kIntImm, kSETL,
+    kRegInt, kVoid, kReg
 };
 
-std::map<std::string, unsigned int> lab_list;
-std::multimap<std::string, unsigned int> lab_fill;
-std::string section_tag;
-
 template <typename T>
 inline void WriteBytes(std::ofstream &out, T &&content) {
     out.write((char *)&content, sizeof(content));
@@ -86,13 +87,13 @@ void Generator::PrintError(const char *description) {
 }
 
 void Generator::HandleLabelRef() {
-    for (const auto &i : lab_list) {
+    for (const auto &i : lab_list_) {
         if (i.first == lexer_.lab_val()) {
             WriteBytes(out_, i.second);
             return;
         }
     }
-    lab_fill.insert(std::map<std::string, unsigned int>::value_type(lexer_.lab_val(), out_.tellp()));
+    lab_fill_.insert(std::map<std::string, unsigned int>::value_type(lexer_.lab_val(), out_.tellp()));
     unsigned int zero = 0;
     WriteBytes(out_, zero);
 }
@@ -303,25 +304,25 @@ int Generator::Generate() {
 
         switch (tok_type) {
             case kLabelDef: {
-                if (lab_list.count(lexer_.lab_val()) != 0) {
+                if (lab_list_.count(lexer_.lab_val()) != 0) {
                     PrintError("conflicted label defination");
                 }
                 else {
                     unsigned int jmp_pos = (unsigned int)cur_pos;
                     if (lexer_.lab_val().substr(0, 2) == "__") {
-                        section_tag = lexer_.lab_val().substr(2);
+                        section_tag_ = lexer_.lab_val().substr(2);
                     }
                     else {
-                        if (section_tag == "CONSTANT") {
-                            jmp_pos = jmp_pos - lab_list["__CONSTANT"];
+                        if (section_tag_ == "CONSTANT") {
+                            jmp_pos = jmp_pos - lab_list_["__CONSTANT"];
                         }
-                        else if (section_tag == "PROGRAM") {
-                            jmp_pos = jmp_pos - lab_list["__PROGRAM"];
+                        else if (section_tag_ == "PROGRAM") {
+                            jmp_pos = jmp_pos - lab_list_["__PROGRAM"];
                         }
                     }
-                    lab_list[lexer_.lab_val()] = jmp_pos;
+                    lab_list_[lexer_.lab_val()] = jmp_pos;
                     auto found = false;
-                    for (const auto &i : lab_fill) {
+                    for (const auto &i : lab_fill_) {
                         if (i.first == lexer_.lab_val()) {
                             out_.seekp(i.second);
                             unsigned int temp = (unsigned int)jmp_pos;
@@ -330,7 +331,7 @@ int Generator::Generate() {
                             if (!found) found = true;
                         }
                     }
-                    if (found) lab_fill.erase(lexer_.lab_val());
+                    if (found) lab_fill_.erase(lexer_.lab_val());
                 }
                 break;
             }
@@ -380,8 +381,8 @@ int Generator::Generate() {
                 break;
             }
             case kEOF: {
-                if (!lab_fill.empty()) {
-                    for (const auto &i : lab_fill) {
+                if (!lab_fill_.empty()) {
+                    for (const auto &i : lab_fill_) {
                         fprintf(stderr, "position: %u \033[31m\033[1merror:\033[0m undefined label \"%s\"\n", (unsigned int)i.second, i.first.c_str());
                         ++error_num_;
                     }
@@ -2,6 +2,8 @@
 #define ZVM_TOOLS_ZASM_GEN_H_
 
 #include <fstream>
+#include <string>
+#include <map>
 
 #include "lexer.h"
 
@@ -25,6 +27,10 @@ private:
     Lexer &lexer_;
     std::ofstream &out_;
     unsigned int error_num_;
+    // position of labels, and positions that wait for labels
+    std::map<std::string, unsigned int> lab_list_;
+    std::multimap<std::string, unsigned int> lab_fill_;
+    std::string section_tag_;
 };
 
 #endif // ZVM_TOOLS_ZASM_GEN_H_
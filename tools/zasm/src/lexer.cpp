@@ -18,6 +18,11 @@ const char *op_str[] = {
     "ITF", "FTI", "ITS", "STI", "FTS", "STF",
     "ADDS", "CPS", "LENS", "EQS", "GETS", "SETS",
     "ADDL", "CPL", "LENL", "EQL", "GETL", "SETL",
+    "FINDS", "SPLITS",
+    "NEWB", "GETB", "SETB", "LENB",
+    "NEWM", "GETM", "SETM", "DELM", "LENM", "HASM", "NEXTM",
+    "SORTL", "BSEARCHL",
+    "SPAWN", "YIELD", "JOIN",
     "DEF", "HEADER"
 };
 
@@ -77,27 +82,26 @@ int Lexer::PrintError(const char *description) {
 
 int Lexer::NextToken() {
     if (in_.eof()) return kEOF;
-    static char last_char = ' ';
 
     auto IsEndOfLine = [&]() {
-        return in_.eof() || last_char == '\n' || last_char == '\r';
+        return in_.eof() || last_char_ == '\n' || last_char_ == '\r';
     };
 
-    while (!IsEndOfLine() && isspace(last_char)) in_ >> last_char;
+    while (!IsEndOfLine() && isspace(last_char_)) in_ >> last_char_;
 
-    if (last_char == ';') {
+    if (last_char_ == ';') {
         do {
-            in_ >> last_char;
+            in_ >> last_char_;
         } while (!IsEndOfLine());
     }
 
-    if (isalpha(last_char) || last_char == '_') {
+    if (isalpha(last_char_) || last_char_ == '_') {
         std::string id;
 
         do {
-            id += last_char;
-            in_ >> last_char;
-        } while (!in_.eof() && (isalnum(last_char) || last_char == '_'));
+            id += last_char_;
+            in_ >> last_char_;
+        } while (!in_.eof() && (isalnum(last_char_) || last_char_ == '_'));
         transform(id.begin(), id.end(), id.begin(), toupper);
 
         int temp = 0;
@@ -109,9 +113,9 @@ int Lexer::NextToken() {
             reg_val_ = temp;
             return kRegister;
         }
-        else if(last_char == ':') {
+        else if(last_char_ == ':') {
             lab_val_ = id;
-            in_ >> last_char;
+            in_ >> last_char_;
             return kLabelDef;
         }
         else {
@@ -120,38 +124,38 @@ int Lexer::NextToken() {
         }
     }
 
-    if (isdigit(last_char) || last_char == '.' || last_char == '-') {
+    if (isdigit(last_char_) || last_char_ == '.' || last_char_ == '-') {
         std::string num_str;
         char *end_pos = nullptr;
-        auto is_double = (last_char == '.');
+        auto is_double = (last_char_ == '.');
         auto IsValidConv = [&end_pos, &num_str]() {
             return end_pos - num_str.c_str() == num_str.length();
         };
 
-        if (last_char == '0') {
-            in_ >> last_char;
-            if (toupper(last_char) == 'X') {
-                in_ >> last_char;
-                while (isalnum(last_char)) {
-                    num_str += last_char;
-                    in_ >> last_char;
+        if (last_char_ == '0') {
+            in_ >> last_char_;
+            if (toupper(last_char_) == 'X') {
+                in_ >> last_char_;
+                while (isalnum(last_char_)) {
+                    num_str += last_char_;
+                    in_ >> last_char_;
                 }
                 num_val_ = (unsigned int)strtoul(num_str.c_str(), &end_pos, 16);
                 return IsValidConv() ? kNumber : PrintError("invalid hex");
             }
-            else if (last_char == ' ' || last_char == ';' || last_char == ',' || IsEndOfLine()) {
+            else if (last_char_ == ' ' || last_char_ == ';' || last_char_ == ',' || IsEndOfLine()) {
                 num_val_ = 0;
                 return kNumber;
             }
-            else if (last_char != '.') {
+            else if (last_char_ != '.') {
                 return PrintError("invalid immediate number");
             }
         }
         do {
-            if (!is_double && last_char == '.') is_double = true;
-            num_str += last_char;
-            in_ >> last_char;
-        } while (isdigit(last_char) || last_char == '.' || last_char == 'e');
+            if (!is_double && last_char_ == '.') is_double = true;
+            num_str += last_char_;
+            in_ >> last_char_;
+        } while (isdigit(last_char_) || last_char_ == '.' || last_char_ == 'e');
 
         if (is_double) {
             float_val_ = strtod(num_str.c_str(), &end_pos);
@@ -163,15 +167,15 @@ int Lexer::NextToken() {
         }
     }
 
-    if (last_char == '\'') {
+    if (last_char_ == '\'') {
         std::string str;
-        in_ >> last_char;
-        while (last_char != '\'') {
-            str += last_char;
-            in_ >> last_char;
+        in_ >> last_char_;
+        while (last_char_ != '\'') {
+            str += last_char_;
+            in_ >> last_char_;
             if (IsEndOfLine()) return PrintError("expected \"\'\"");
         }
-        in_ >> last_char;
+        in_ >> last_char_;
 
         if (str.length() == 1) {
             char_val_ = (unsigned char)str[0];
@@ -195,35 +199,35 @@ int Lexer::NextToken() {
         }
     }
 
-    if (last_char == '\"') {
+    if (last_char_ == '\"') {
         std::string str, temp;
-        in_ >> last_char;
+        in_ >> last_char_;
 
-        while (last_char != '\"') {
-            if (last_char == '\\') {
-                in_ >> last_char;
+        while (last_char_ != '\"') {
+            if (last_char_ == '\\') {
+                in_ >> last_char_;
                 if (IsEndOfLine()) return PrintError("expected \'\"\'");
-                temp += last_char;
-                if (last_char == 'x') {
+                temp += last_char_;
+                if (last_char_ == 'x') {
                     for (int i = 0; i < 2; ++i) {
-                        in_ >> last_char;
+                        in_ >> last_char_;
                         if (IsEndOfLine()) return PrintError("expected \'\"\'");
-                        temp += last_char;
+                        temp += last_char_;
                     }
                 }
                 auto ret = GetDLE(temp);
                 if (ret != kError) {
-                    last_char = ret;
+                    last_char_ = ret;
                 }
                 else {
                     return PrintError("unknown escaped character");
                 }
             }
-            str += last_char;
-            in_ >> last_char;
+            str += last_char_;
+            in_ >> last_char_;
             if (IsEndOfLine()) return PrintError("expected \'\"\'");
         }
-        in_ >> last_char;
+        in_ >> last_char_;
 
         str_val_ = str;
         return kString;
@@ -231,11 +235,11 @@ int Lexer::NextToken() {
 
     if (IsEndOfLine()) {
         ++line_pos_;
-        in_ >> last_char;
+        in_ >> last_char_;
         return NextToken();
     }
 
-    auto cur_char = last_char;
-    in_ >> last_char;
+    auto cur_char = last_char_;
+    in_ >> last_char_;
     return cur_char;
 }
@@ -15,6 +15,11 @@ enum InstOp {
     ITF, FTI, ITS, STI, FTS, STF,   // Convert
     ADDS, CPS, LENS, EQS, GETS, SETS,   // String
     ADDL, CPL, LENL, EQL, GETL, SETL,   // List
+    FINDS, SPLITS,   // String (extension)
+    NEWB, GETB, SETB, LENB,   // Buffer
+    NEWM, GETM, SETM, DELM, LENM, HASM, NEXTM,   // Map
+    SORTL, BSEARCHL,   // List (extension)
+    SPAWN, YIELD, JOIN,   // Fiber
     DEF, HEADER   // Pseudo instruction
 };
 
@@ -33,7 +38,7 @@ enum TokenType {
 
 class Lexer {
 public:
-    Lexer(std::ifstream &in) : in_(in), line_pos_(1), error_num_(0) {
+    Lexer(std::ifstream &in) : in_(in), last_char_(' '), line_pos_(1), error_num_(0) {
         if (!in) {
             PrintError("invalid file");
         }
@@ -59,6 +64,7 @@ private:
     int PrintError(const char *description);
 
     std::ifstream &in_;
+    char last_char_;
     unsigned int line_pos_;
     unsigned int error_num_;
 
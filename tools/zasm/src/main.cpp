@@ -83,9 +83,9 @@ int main(int argc, const char *argv[]) {
         }
     }
 
-    auto out_file = GetOutputFile(argv[1]).c_str();
+    auto out_file = GetOutputFile(argv[1]);
     out.open(out_file, std::ofstream::binary);
-    GenerateBytecode(in, out, out_file);
+    GenerateBytecode(in, out, out_file.c_str());
 
     return 0;
 }